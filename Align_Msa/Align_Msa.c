@@ -0,0 +1,601 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <omp.h>
+
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//Define guide tree methods
+#define UPGMA 0
+#define NJ 1
+//Define output formats
+#define TEXT 0
+#define FASTA 1
+//Distinct residue characters allowed in one input
+#define MAX_ALPHABET 64
+
+#include "../Common/Fasta.h"
+
+//Rows of a partial alignment, every row has length characters with '-' for gaps
+typedef struct {
+	int numRows;
+	int length;
+	int* members;   //record index of each row
+	char** rows;
+} Profile;
+
+long int scoreOnly(Record* a, Record* b, int* row);
+int computeDistances(double* dist, int thread_count, int* numThreads, long* cells);
+void buildUpgma(double* dist);
+void buildNj(double* dist);
+Profile* alignNode(int node);
+Profile* leafProfile(int r);
+Profile* alignProfiles(Profile* x, Profile* y);
+int* columnCounts(Profile* p);
+float columnScore(int* x, int nX, int* y, int nY);
+float gapColumnScore(int* x, int nX);
+void freeProfile(Profile* p);
+long int sumOfPairs(Profile* p);
+void printTree(int node);
+void printResults(Profile* msa, double distTime, double treeTime, double alignTime, long pairCells, int numThreads);
+void writeFasta(Profile* msa);
+char* baseName(char* path);
+int max(int x, int y);
+int min(int x, int y);
+
+//Default scores, can be overridden from the command line
+int matchScore = 4;
+int mismatchScore = -1;
+int gapScore = -5;
+int treeMethod = UPGMA;
+int outputFormat = TEXT;
+const char* methodNames[] = {"upgma", "nj"};
+const char* formatNames[] = {"text", "fasta"};
+Record* records;
+int numRecords = 0;
+char* inputName;
+//residue characters mapped to 0..alphabetSize-1, -1 for characters not seen
+int symbolCode[256];
+int alphabetSize = 0;
+//Guide tree, nodes below numRecords are the sequences and the rest joins made by
+//the tree method, the last one is the root
+int* leftChild, * rightChild;
+double* branchLength;
+int numNodes = 0;
+//Matrix cells filled by the progressive phase
+long profileCells = 0;
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		printf("Please enter in this format: Align_Msa <fasta_file> <num_threads> [-s match mismatch gap] [-g upgma|nj] [-f text|fasta]\n");
+		return 1;
+	}
+	char* inputFile = argv[1];
+	int thread_count = atoi(argv[2]);
+	for (int a = 3; a < argc; a++) {
+		if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+			matchScore = atoi(argv[++a]);
+			mismatchScore = atoi(argv[++a]);
+			gapScore = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-g") == 0 && a + 1 < argc) {
+			treeMethod = strcmp(argv[++a], methodNames[NJ]) == 0 ? NJ : UPGMA;
+		}
+		else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			outputFormat = strcmp(argv[++a], formatNames[FASTA]) == 0 ? FASTA : TEXT;
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	numRecords = readFasta(inputFile, &records);
+	if (numRecords < 1) {
+		printf("Unable to read sequences from %s\n", inputFile);
+		return 1;
+	}
+	inputName = baseName(inputFile);
+	//only letters are residues, '-' and '.' would be aligned as residues and end up
+	//indistinguishable from the gaps of the alignment, so they and anything else are
+	//dropped with a warning
+	for (int r = 0; r < numRecords; r++) {
+		int kept = 0;
+		for (int c = 0; c < records[r].length; c++) {
+			if (isalpha((unsigned char)records[r].seq[c]))
+				records[r].seq[kept++] = records[r].seq[c];
+		}
+		if (kept < records[r].length)
+			fprintf(stderr, "Warning: %d gap or non residue characters removed from %s\n", records[r].length - kept, records[r].name);
+		records[r].seq[kept] = '\0';
+		records[r].length = kept;
+	}
+	memset(symbolCode, -1, sizeof(symbolCode));
+	for (int r = 0; r < numRecords; r++) {
+		for (int c = 0; c < records[r].length; c++) {
+			unsigned char base = records[r].seq[c];
+			if (symbolCode[base] < 0) {
+				if (alphabetSize == MAX_ALPHABET) {
+					printf("More than %d distinct residues in %s\n", MAX_ALPHABET, inputFile);
+					return 1;
+				}
+				symbolCode[base] = alphabetSize++;
+			}
+		}
+	}
+	//the alignment is written in few large blocks
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	double* dist = malloc((long)numRecords * numRecords * sizeof(double));
+	leftChild = malloc(2 * numRecords * sizeof(int));
+	rightChild = malloc(2 * numRecords * sizeof(int));
+	branchLength = malloc(2 * numRecords * sizeof(double));
+	if (!dist || !leftChild || !rightChild || !branchLength) {
+		printf("Unable to allocate the distance matrix for %d sequences\n", numRecords);
+		return 1;
+	}
+	numNodes = numRecords;
+	for (int r = 0; r < numRecords; r++) {
+		leftChild[r] = rightChild[r] = -1;
+		branchLength[r] = 0;
+	}
+	int numThreads = 1;
+	long pairCells = 0;
+
+	//all pairs phase, one score only alignment per pair spread over the threads
+	double initialTime = omp_get_wtime();
+	if (!computeDistances(dist, thread_count, &numThreads, &pairCells)) {
+		printf("Unable to allocate the score rows of the all pairs phase\n");
+		return 1;
+	}
+	double distTime = omp_get_wtime();
+
+	//guide tree
+	if (treeMethod == NJ)
+		buildNj(dist);
+	else
+		buildUpgma(dist);
+	free(dist);
+	double treeTime = omp_get_wtime();
+
+	//progressive phase, the two subtrees of a join are independent and run as tasks
+	Profile* msa;
+	#pragma omp parallel num_threads(thread_count) default(none) shared(msa, numNodes)
+	{
+		#pragma omp single
+		msa = alignNode(numNodes - 1);
+	}
+	double finalTime = omp_get_wtime();
+
+	if (outputFormat == FASTA) {
+		writeFasta(msa);
+		return 0;
+	}
+	printResults(msa, distTime - initialTime, treeTime - distTime, finalTime - treeTime, pairCells, numThreads);
+	return 0;
+}
+
+//Distance of every pair from its global score, 1 - score / (matchScore * shorter
+//length), so identical sequences are 0 apart and unrelated ones about 1 or more.
+//Returns 0 if a thread could not allocate its score row.
+int computeDistances(double* dist, int thread_count, int* numThreads, long* cells) {
+	int longest = 0;
+	for (int r = 0; r < numRecords; r++)
+		longest = max(longest, records[r].length);
+	long total = 0;
+	int failed = 0;
+
+	#pragma omp parallel num_threads(thread_count) \
+	default(none) shared(dist, records, numRecords, longest, numThreads, matchScore, failed) reduction(+:total)
+	{
+		//one score row per thread, reused for every pair
+		int* row = malloc((longest + 1) * sizeof(int));
+		if (!row) {
+			#pragma omp atomic write
+			failed = 1;
+		}
+		*numThreads = omp_get_num_threads();
+		//rows of the triangle shrink, hand them out one at a time
+		#pragma omp for schedule(dynamic, 1)
+		for (int a = 0; a < numRecords; a++) {
+			//a thread without a row still takes part in the loop but skips its share
+			if (!row)
+				continue;
+			dist[(long)a * numRecords + a] = 0;
+			for (int b = a + 1; b < numRecords; b++) {
+				long int score = scoreOnly(&records[a], &records[b], row);
+				int shorter = min(records[a].length, records[b].length);
+				double d = shorter > 0 ? 1.0 - (double)score / ((double)matchScore * shorter) : 1.0;
+				if (d < 0)
+					d = 0;
+				dist[(long)a * numRecords + b] = dist[(long)b * numRecords + a] = d;
+				total += (long)records[a].length * records[b].length;
+			}
+		}
+		free(row);
+	}
+	*cells = total;
+	return !failed;
+}
+
+//Global score of the pair with a single row over b, no traceback
+long int scoreOnly(Record* a, Record* b, int* row) {
+	int cols = b->length;
+	for (int j = 0; j <= cols; j++)
+		row[j] = j * gapScore;
+	for (int i = 0; i < a->length; i++) {
+		char s = a->seq[i];
+		int diag = row[0];
+		int left = (i + 1) * gapScore;
+		row[0] = left;
+		for (int j = 1; j <= cols; j++) {
+			int up = row[j];
+			int score = diag + (b->seq[j-1] == s ? matchScore : mismatchScore);
+			if (left + gapScore > score)
+				score = left + gapScore;
+			if (up + gapScore > score)
+				score = up + gapScore;
+			diag = up;
+			left = score;
+			row[j] = score;
+		}
+	}
+	return row[cols];
+}
+
+//Joins the two closest clusters until one is left, the distance of a join to the
+//others is the size weighted mean of its two halves. Slot a of the matrix is reused
+//for the join and slot b retired.
+void buildUpgma(double* dist) {
+	int n = numRecords;
+	int* nodeOf = malloc(n * sizeof(int));
+	int* size = malloc(n * sizeof(int));
+	double* height = malloc(2 * n * sizeof(double));
+	for (int s = 0; s < n; s++) {
+		nodeOf[s] = s;
+		size[s] = 1;
+		height[s] = 0;
+	}
+	for (int step = 1; step < n; step++) {
+		int a = -1, b = -1;
+		double best = 0;
+		for (int x = 0; x < n; x++) {
+			if (nodeOf[x] < 0)
+				continue;
+			for (int y = x + 1; y < n; y++) {
+				if (nodeOf[y] >= 0 && (a < 0 || dist[(long)x * n + y] < best)) {
+					best = dist[(long)x * n + y];
+					a = x;
+					b = y;
+				}
+			}
+		}
+		int node = numNodes++;
+		leftChild[node] = nodeOf[a];
+		rightChild[node] = nodeOf[b];
+		height[node] = best / 2;
+		branchLength[nodeOf[a]] = height[node] - height[nodeOf[a]];
+		branchLength[nodeOf[b]] = height[node] - height[nodeOf[b]];
+		for (int x = 0; x < n; x++) {
+			if (nodeOf[x] < 0 || x == a || x == b)
+				continue;
+			double d = (size[a] * dist[(long)a * n + x] + size[b] * dist[(long)b * n + x]) / (size[a] + size[b]);
+			dist[(long)a * n + x] = dist[(long)x * n + a] = d;
+		}
+		nodeOf[a] = node;
+		size[a] += size[b];
+		nodeOf[b] = -1;
+	}
+	branchLength[numNodes - 1] = 0;
+	free(nodeOf);
+	free(size);
+	free(height);
+}
+
+//Neighbour joining, joins the pair minimising (n - 2) d(a, b) - r(a) - r(b) where r
+//is the sum of distances to the active clusters. The last two are joined at the root.
+void buildNj(double* dist) {
+	int n = numRecords;
+	int* nodeOf = malloc(n * sizeof(int));
+	double* r = malloc(n * sizeof(double));
+	for (int s = 0; s < n; s++)
+		nodeOf[s] = s;
+	for (int active = n; active > 1; active--) {
+		for (int x = 0; x < n; x++) {
+			r[x] = 0;
+			if (nodeOf[x] < 0)
+				continue;
+			for (int y = 0; y < n; y++) {
+				if (nodeOf[y] >= 0)
+					r[x] += dist[(long)x * n + y];
+			}
+		}
+		int a = -1, b = -1;
+		double best = 0;
+		for (int x = 0; x < n; x++) {
+			if (nodeOf[x] < 0)
+				continue;
+			for (int y = x + 1; y < n; y++) {
+				if (nodeOf[y] < 0)
+					continue;
+				double q = (active - 2) * dist[(long)x * n + y] - r[x] - r[y];
+				if (a < 0 || q < best) {
+					best = q;
+					a = x;
+					b = y;
+				}
+			}
+		}
+		double dab = dist[(long)a * n + b];
+		double la = active > 2 ? dab / 2 + (r[a] - r[b]) / (2.0 * (active - 2)) : dab / 2;
+		if (la < 0)
+			la = 0;
+		if (la > dab)
+			la = dab;
+		int node = numNodes++;
+		leftChild[node] = nodeOf[a];
+		rightChild[node] = nodeOf[b];
+		branchLength[nodeOf[a]] = la;
+		branchLength[nodeOf[b]] = dab - la;
+		for (int x = 0; x < n; x++) {
+			if (nodeOf[x] < 0 || x == a || x == b)
+				continue;
+			double d = (dist[(long)a * n + x] + dist[(long)b * n + x] - dab) / 2;
+			dist[(long)a * n + x] = dist[(long)x * n + a] = d;
+		}
+		nodeOf[a] = node;
+		nodeOf[b] = -1;
+	}
+	branchLength[numNodes - 1] = 0;
+	free(nodeOf);
+	free(r);
+}
+
+//Aligns the sequences below node, the children of a join are aligned in parallel
+Profile* alignNode(int node) {
+	if (node < numRecords)
+		return leafProfile(node);
+	Profile* left, * right;
+	#pragma omp task default(none) shared(left, leftChild) firstprivate(node)
+	left = alignNode(leftChild[node]);
+	right = alignNode(rightChild[node]);
+	#pragma omp taskwait
+	Profile* joined = alignProfiles(left, right);
+	freeProfile(left);
+	freeProfile(right);
+	return joined;
+}
+
+Profile* leafProfile(int r) {
+	Profile* p = malloc(sizeof(Profile));
+	p->numRows = 1;
+	p->length = records[r].length;
+	p->members = malloc(sizeof(int));
+	p->rows = malloc(sizeof(char*));
+	p->members[0] = r;
+	p->rows[0] = strdup(records[r].seq);
+	return p;
+}
+
+//Needleman-Wunsch between two profiles, columns of x are the rows of the matrix and
+//columns of y its columns. A pair of columns scores the mean over all pairs of their
+//characters, gap against gap scoring 0, and a gap column the mean of the other
+//column against gaps. Ties are broken like NeedlemanW, diag, then left, then up.
+Profile* alignProfiles(Profile* x, Profile* y) {
+	int rows = x->length + 1;
+	int cols = y->length + 1;
+	int* countsX = columnCounts(x);
+	int* countsY = columnCounts(y);
+	float* gapX = malloc(rows * sizeof(float));
+	float* gapY = malloc(cols * sizeof(float));
+	float* scoreMatrix = malloc((long)rows * cols * sizeof(float));
+	char* tbMatrix = malloc((long)rows * cols);
+	if (!gapX || !gapY || !scoreMatrix || !tbMatrix) {
+		printf("Unable to allocate matrices for profiles of %d x %d columns\n", rows - 1, cols - 1);
+		exit(1);
+	}
+	for (int i = 1; i < rows; i++)
+		gapX[i] = gapColumnScore(&countsX[(i - 1) * (alphabetSize + 1)], x->numRows);
+	for (int j = 1; j < cols; j++)
+		gapY[j] = gapColumnScore(&countsY[(j - 1) * (alphabetSize + 1)], y->numRows);
+
+	scoreMatrix[0] = 0;
+	tbMatrix[0] = NONE;
+	for (int j = 1; j < cols; j++) {
+		scoreMatrix[j] = scoreMatrix[j - 1] + gapY[j];
+		tbMatrix[j] = LEFT;
+	}
+	for (int i = 1; i < rows; i++) {
+		long index = (long)cols * i;
+		scoreMatrix[index] = scoreMatrix[index - cols] + gapX[i];
+		tbMatrix[index] = UP;
+		int* cx = &countsX[(i - 1) * (alphabetSize + 1)];
+		for (int j = 1; j < cols; j++) {
+			index++;
+			float diag = scoreMatrix[index - cols - 1] + columnScore(cx, x->numRows, &countsY[(j - 1) * (alphabetSize + 1)], y->numRows);
+			float left = scoreMatrix[index - 1] + gapY[j];
+			float up = scoreMatrix[index - cols] + gapX[i];
+			float max = diag;
+			char pred = DIAG;
+			if (left > max) {
+				max = left;
+				pred = LEFT;
+			}
+			if (up > max) {
+				max = up;
+				pred = UP;
+			}
+			scoreMatrix[index] = max;
+			tbMatrix[index] = pred;
+		}
+	}
+	#pragma omp atomic
+	profileCells += (long)(rows - 1) * (cols - 1);
+
+	//walk back once for the length, then write the rows from the back
+	int length = 0;
+	for (int i = rows - 1, j = cols - 1; i > 0 || j > 0; length++) {
+		char pred = tbMatrix[(long)cols * i + j];
+		i -= pred != LEFT;
+		j -= pred != UP;
+	}
+	Profile* p = malloc(sizeof(Profile));
+	p->numRows = x->numRows + y->numRows;
+	p->length = length;
+	p->members = malloc(p->numRows * sizeof(int));
+	p->rows = malloc(p->numRows * sizeof(char*));
+	for (int r = 0; r < p->numRows; r++) {
+		p->members[r] = r < x->numRows ? x->members[r] : y->members[r - x->numRows];
+		p->rows[r] = malloc(length + 1);
+		p->rows[r][length] = '\0';
+	}
+	for (int i = rows - 1, j = cols - 1, c = length - 1; c >= 0; c--) {
+		char pred = tbMatrix[(long)cols * i + j];
+		for (int r = 0; r < x->numRows; r++)
+			p->rows[r][c] = pred == LEFT ? '-' : x->rows[r][i - 1];
+		for (int r = 0; r < y->numRows; r++)
+			p->rows[x->numRows + r][c] = pred == UP ? '-' : y->rows[r][j - 1];
+		i -= pred != LEFT;
+		j -= pred != UP;
+	}
+	free(countsX);
+	free(countsY);
+	free(gapX);
+	free(gapY);
+	free(scoreMatrix);
+	free(tbMatrix);
+	return p;
+}
+
+//Count of each residue in every column of the profile, alphabetSize counts per
+//column followed by the number of gaps
+int* columnCounts(Profile* p) {
+	int stride = alphabetSize + 1;
+	int* counts = calloc((long)p->length * stride, sizeof(int));
+	for (int r = 0; r < p->numRows; r++) {
+		for (int c = 0; c < p->length; c++) {
+			char base = p->rows[r][c];
+			counts[c * stride + (base == '-' ? alphabetSize : symbolCode[(unsigned char)base])]++;
+		}
+	}
+	return counts;
+}
+
+//Mean sum of pairs score of two columns, matches are counted per residue so the
+//cost is the alphabet size rather than the number of rows
+float columnScore(int* x, int nX, int* y, int nY) {
+	int same = 0;
+	for (int a = 0; a < alphabetSize; a++)
+		same += x[a] * y[a];
+	int residuesX = nX - x[alphabetSize];
+	int residuesY = nY - y[alphabetSize];
+	long sum = (long)mismatchScore * residuesX * residuesY + (long)(matchScore - mismatchScore) * same
+		+ (long)gapScore * ((long)x[alphabetSize] * residuesY + (long)y[alphabetSize] * residuesX);
+	return (float)sum / ((float)nX * nY);
+}
+
+//Mean score of a column against a column of gaps
+float gapColumnScore(int* x, int nX) {
+	return (float)gapScore * (nX - x[alphabetSize]) / nX;
+}
+
+void freeProfile(Profile* p) {
+	for (int r = 0; r < p->numRows; r++)
+		free(p->rows[r]);
+	free(p->rows);
+	free(p->members);
+	free(p);
+}
+
+//Sum over all pairs of rows and all columns of the pair score, gap against gap 0
+long int sumOfPairs(Profile* p) {
+	int* counts = columnCounts(p);
+	long int total = 0;
+	for (int c = 0; c < p->length; c++) {
+		int* column = &counts[c * (alphabetSize + 1)];
+		long residues = p->numRows - column[alphabetSize];
+		long same = 0;
+		for (int a = 0; a < alphabetSize; a++)
+			same += (long)column[a] * (column[a] - 1) / 2;
+		total += same * matchScore + (residues * (residues - 1) / 2 - same) * mismatchScore
+			+ residues * column[alphabetSize] * gapScore;
+	}
+	free(counts);
+	return total;
+}
+
+//Newick form of the subtree below node
+void printTree(int node) {
+	if (node < numRecords) {
+		printf("%s:%.4f", records[node].name, branchLength[node]);
+		return;
+	}
+	printf("(");
+	printTree(leftChild[node]);
+	printf(",");
+	printTree(rightChild[node]);
+	printf(")");
+	if (node != numNodes - 1)
+		printf(":%.4f", branchLength[node]);
+}
+
+void printResults(Profile* msa, double distTime, double treeTime, double alignTime, long pairCells, int numThreads) {
+	long residues = 0;
+	int nameWidth = 0;
+	for (int r = 0; r < numRecords; r++) {
+		residues += records[r].length;
+		nameWidth = max(nameWidth, strlen(records[r].name));
+	}
+	//rows in input order
+	int* rowOf = malloc(numRecords * sizeof(int));
+	for (int r = 0; r < msa->numRows; r++)
+		rowOf[msa->members[r]] = r;
+	printf("\n======================================\n");
+	printf("PROGRAM FINISHED\n");
+	printf("Aligned %d sequences (%ld residues) from %s\n", numRecords, residues, inputName);
+	printf("1) GUIDE TREE (%s): ", methodNames[treeMethod]);
+	printTree(numNodes - 1);
+	printf(";\n");
+	printf("2) ALIGNMENT LENGTH: %d\n", msa->length);
+	printf("3) ALIGNMENT:\n");
+	for (int r = 0; r < numRecords; r++)
+		printf("\t%-*s %s\n", nameWidth, records[r].name, msa->rows[rowOf[r]]);
+	printf("4) SUM OF PAIRS SCORE: %ld\n", sumOfPairs(msa));
+	printf("5) TIME ELAPSED: %fs (distances %fs, guide tree %fs, progressive %fs, %ld profile cells)\n",
+		distTime + treeTime + alignTime, distTime, treeTime, alignTime, profileCells);
+	printf("6) GCUPS (all pairs): %f\n", distTime > 0 ? pairCells / distTime / 1e9 : 0.0);
+	printf("7) NUMBER OF THREADS USED: %d\n", numThreads);
+	printf("======================================\n");
+	free(rowOf);
+}
+
+void writeFasta(Profile* msa) {
+	int* rowOf = malloc(numRecords * sizeof(int));
+	for (int r = 0; r < msa->numRows; r++)
+		rowOf[msa->members[r]] = r;
+	for (int r = 0; r < numRecords; r++)
+		printf(">%s\n%s\n", records[r].name, msa->rows[rowOf[r]]);
+	free(rowOf);
+}
+
+char* baseName(char* path) {
+	char* slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+int max(int x, int y) {
+	if (x > y)
+		return x;
+	else
+		return y;
+}
+
+int min(int x, int y) {
+	if (x > y)
+		return y;
+	else
+		return x;
+}
@@ -0,0 +1,197 @@
+//Fill kernel of Align_Omp, included once per score width. The includer defines
+//SCORE_T, SCORE_BITS, SCORE_MIN, SCORE_MAX and KERNEL(name), which appends the
+//width to every function so each inclusion is its own copy of the code.
+//
+//local and traceback are constants at every call site and the kernels are always
+//inlined, so each combination per width is compiled separately and the inner loop
+//has no branch on either option. traceback is 0 without a traceback matrix, or the
+//layout of the matrix, TB_ROWS or TB_TILES.
+
+//Computes one cell. Neighbours are read into int so sums cannot wrap in narrow
+//widths, overflow records whether the result left the range of SCORE_T.
+static inline __attribute__((always_inline)) int KERNEL(similarityScore)(int i, int j, SCORE_T* scoreMatrix, int* tbMatrix, int* overflow, const int local, const int traceback) {
+	long index = (long)subjectSize * i + j;
+
+	//Get element above
+	int up = scoreMatrix[index-subjectSize] + gapScore;
+
+	//Get element on the left
+	int left = scoreMatrix[index-1] + gapScore;
+
+	//Get element on the diagonal
+	int diag = scoreMatrix[index-subjectSize-1] + matchMismatchScore(i, j);
+
+	//Calculates the maximum
+	int max = diag;
+	int pred = DIAG;
+	if (left > max) {
+		max = left;
+		pred = LEFT;
+	}
+	if (up > max) {
+		max = up;
+		pred = UP;
+	}
+	if (local && max <= 0) {
+		max = 0;
+		pred = NONE;
+	}
+	if (SCORE_BITS < 32)
+		*overflow |= (max > SCORE_MAX) | (max < SCORE_MIN);
+	//Inserts the value in the similarity and traceback matrixes
+	scoreMatrix[index] = max;
+	if (traceback)
+		tbMatrix[traceback == TB_TILES ? tileIndex(i, j) : index] = pred;
+	return max;
+}
+
+//Anti-diagonal wavefront shared by every mode but X-drop, returns nonzero if a
+//score left the range of SCORE_T
+static inline __attribute__((always_inline)) int KERNEL(fillMatrix)(SCORE_T* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads, const int local, const int traceback) {
+	int numDiag = querySize + subjectSize - 3;
+	int bestScore = 0;
+	int bestPos = 0;
+	int overflow = 0;
+	int start_i, start_j, numElements;
+
+	#pragma omp parallel num_threads(thread_count) \
+	default(none) shared(scoreMatrix, tbMatrix, subjectSize, numThreads, numDiag, bestScore, bestPos, overflow, local, traceback) \
+	private(numElements, start_i, start_j)
+	{
+		int threadBest = 0;
+		int threadPos = 0;
+		int threadOverflow = 0;
+		*numThreads = omp_get_num_threads();
+		for (int i = 1; i <= numDiag; i++) {
+			numElements = calcNumDiagRowElements(i);
+			calcFirstDiagElement(&i, &start_i, &start_j);
+			#pragma omp for
+			for (int j = 1; j <= numElements; j++) {
+				int diag_i = start_i - j + 1;
+				int diag_j = start_j + j - 1;
+				int score = KERNEL(similarityScore)(diag_i, diag_j, scoreMatrix, tbMatrix, &threadOverflow, local, traceback);
+				if (local) {
+					//ties go to the first cell in row major order like the serial SmithW
+					int index = subjectSize * diag_i + diag_j;
+					if (score > threadBest || (score == threadBest && score > 0 && index < threadPos)) {
+						threadBest = score;
+						threadPos = index;
+					}
+				}
+			}
+		}
+		#pragma omp critical
+		{
+			overflow |= threadOverflow;
+			if (local && (threadBest > bestScore || (threadBest == bestScore && threadBest > 0 && threadPos < bestPos))) {
+				bestScore = threadBest;
+				bestPos = threadPos;
+			}
+		}
+	}
+	*maxPos = bestPos;
+	cellsComputed = (long)(querySize - 1) * (subjectSize - 1);
+	return overflow;
+}
+
+//Row major fill on the calling thread, for matrices too small to pay for a team
+//and a barrier per anti-diagonal. Same cells and the same local end cell.
+static inline __attribute__((always_inline)) int KERNEL(fillRows)(SCORE_T* scoreMatrix, int* tbMatrix, int* maxPos, const int local, const int traceback) {
+	int bestScore = 0;
+	int bestPos = 0;
+	int overflow = 0;
+	for (int i = 1; i < querySize; i++) {
+		for (int j = 1; j < subjectSize; j++) {
+			int score = KERNEL(similarityScore)(i, j, scoreMatrix, tbMatrix, &overflow, local, traceback);
+			if (local && score > bestScore) {
+				bestScore = score;
+				bestPos = subjectSize * i + j;
+			}
+		}
+	}
+	*maxPos = bestPos;
+	cellsComputed = (long)(querySize - 1) * (subjectSize - 1);
+	return overflow;
+}
+
+//Wavefront over blocks of blockHeight x blockWidth cells. Each block is filled row
+//by row by one thread, so there is a barrier per anti-diagonal of blocks instead of
+//one per anti-diagonal of cells. Block size and schedule come from the tuner.
+static inline __attribute__((always_inline)) int KERNEL(fillBlocks)(SCORE_T* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads, const int local, const int traceback) {
+	int numBlockRows = (querySize - 1 + blockHeight - 1) / blockHeight;
+	int numBlockCols = (subjectSize - 1 + blockWidth - 1) / blockWidth;
+	int numBlockDiag = numBlockRows + numBlockCols - 1;
+	int bestScore = 0;
+	int bestPos = 0;
+	int overflow = 0;
+	omp_set_schedule(blockSchedule, blockChunk);
+
+	#pragma omp parallel num_threads(thread_count) \
+	default(none) shared(scoreMatrix, tbMatrix, querySize, subjectSize, blockHeight, blockWidth, numThreads, numBlockRows, numBlockCols, \
+	numBlockDiag, bestScore, bestPos, overflow, local, traceback)
+	{
+		int threadBest = 0;
+		int threadPos = 0;
+		int threadOverflow = 0;
+		*numThreads = omp_get_num_threads();
+		for (int d = 0; d < numBlockDiag; d++) {
+			int firstBlock = max(0, d - numBlockCols + 1);
+			int lastBlock = min(d, numBlockRows - 1);
+			#pragma omp for schedule(runtime)
+			for (int blockRow = firstBlock; blockRow <= lastBlock; blockRow++) {
+				int blockCol = d - blockRow;
+				int iEnd = min(querySize, 1 + (blockRow + 1) * blockHeight);
+				int jEnd = min(subjectSize, 1 + (blockCol + 1) * blockWidth);
+				for (int i = 1 + blockRow * blockHeight; i < iEnd; i++) {
+					for (int j = 1 + blockCol * blockWidth; j < jEnd; j++) {
+						int score = KERNEL(similarityScore)(i, j, scoreMatrix, tbMatrix, &threadOverflow, local, traceback);
+						if (local) {
+							int index = subjectSize * i + j;
+							if (score > threadBest || (score == threadBest && score > 0 && index < threadPos)) {
+								threadBest = score;
+								threadPos = index;
+							}
+						}
+					}
+				}
+			}
+		}
+		#pragma omp critical
+		{
+			overflow |= threadOverflow;
+			if (local && (threadBest > bestScore || (threadBest == bestScore && threadBest > 0 && threadPos < bestPos))) {
+				bestScore = threadBest;
+				bestPos = threadPos;
+			}
+		}
+	}
+	*maxPos = bestPos;
+	cellsComputed = (long)(querySize - 1) * (subjectSize - 1);
+	return overflow;
+}
+
+//Calls a kernel with the constant local flag and traceback layout of this run
+#define DISPATCH(kernel, ...) \
+	(local ? (layout == TB_TILES ? kernel(__VA_ARGS__, 1, TB_TILES) : layout == TB_ROWS ? kernel(__VA_ARGS__, 1, TB_ROWS) : kernel(__VA_ARGS__, 1, 0)) \
+	: (layout == TB_TILES ? kernel(__VA_ARGS__, 0, TB_TILES) : layout == TB_ROWS ? kernel(__VA_ARGS__, 0, TB_ROWS) : kernel(__VA_ARGS__, 0, 0)))
+
+//Entry point for this width, picks the instantiation for the engine, the mode and
+//the traceback layout
+int KERNEL(fill)(SCORE_T* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads) {
+	int local = mode == LOCAL;
+	int layout = !tbMatrix ? 0 : outOfCore ? TB_TILES : TB_ROWS;
+	if (engine == SERIAL) {
+		*numThreads = 1;
+		return DISPATCH(KERNEL(fillRows), scoreMatrix, tbMatrix, maxPos);
+	}
+	if (engine == BLOCKED)
+		return DISPATCH(KERNEL(fillBlocks), scoreMatrix, tbMatrix, maxPos, thread_count, numThreads);
+	return DISPATCH(KERNEL(fillMatrix), scoreMatrix, tbMatrix, maxPos, thread_count, numThreads);
+}
+
+#undef DISPATCH
+#undef SCORE_T
+#undef SCORE_BITS
+#undef SCORE_MIN
+#undef SCORE_MAX
+#undef KERNEL
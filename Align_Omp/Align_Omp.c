@@ -0,0 +1,1385 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+//Define direction constants
+#define PATH -1
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//Define alignment modes
+#define GLOBAL 0
+#define LOCAL 1
+#define SEMIGLOBAL 2
+#define OVERLAP 3
+#define GLOCAL 4
+#define XDROP 5
+//Define free end gap flags, rows of the matrix are the query and columns the subject
+#define FREE_QUERY_START 1    //first column scores 0, a query prefix may be skipped
+#define FREE_QUERY_END 2      //alignment may end anywhere in the last column
+#define FREE_SUBJECT_START 4  //first row scores 0, a subject prefix may be skipped
+#define FREE_SUBJECT_END 8    //alignment may end anywhere in the last row
+//Score of a cell dropped by X-drop, low enough that adding penalties cannot overflow
+#define NEG_INF (INT_MIN / 2)
+//Define output formats
+#define TEXT 0
+#define SAM 1
+#define PAF 2
+#define JSON 3
+//Result cache file, a header, an open addressing table of slots and a heap for the CIGARs
+#define CACHE_MAGIC 0x31484341434e4c41ULL   //"ALNCACH1"
+#define CACHE_SLOTS (1 << 16)
+#define CACHE_HEAP (1L << 26)
+#define CACHE_PROBES 64
+#define SLOT_EMPTY 0
+#define SLOT_READY 1
+//Cache outcome of this run
+#define CACHE_OFF 0
+#define CACHE_MISS 1
+#define CACHE_STORED 2
+#define CACHE_HIT 3
+//Define fill engines
+#define SERIAL 0
+#define WAVEFRONT 1
+#define BLOCKED 2
+//Engine profile written by calibrate and tune and read once by every run, in the
+//working directory unless -e names another file
+#define ENGINE_PROFILE "engine_profile.txt"
+#define MAX_PROFILE_ENTRIES 16
+//Without a profile a thread count is used once every thread gets this many cells
+#define DEFAULT_CELLS_PER_THREAD (1L << 22)
+//Smallest square timed by calibrate
+#define CALIBRATE_MIN 128
+//Largest square timed by tune, and the block sizes and schedules it tries
+#define TUNE_MAX 2048
+#define NUM_BLOCK_SIZES 5
+#define NUM_SCHEDULES 3
+//Traceback layouts, rows of the matrix one after another or square tiles
+#define TB_ROWS 1
+#define TB_TILES 2
+#define TILE_SHIFT 6
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_MASK (TILE_SIZE - 1)
+#define MB (1024.0 * 1024.0)
+
+typedef struct {
+	long int score;
+	int queryStart, queryEnd, subjectStart, subjectEnd;   //0 based, half open
+	int length, matches, editDistance;
+	char* cigar;   //M, I (query base against a gap) and D (subject base against a gap)
+} Alignment;
+
+typedef struct {
+	uint64_t magic;
+	uint64_t numSlots;
+	uint64_t heapSize;
+	uint64_t heapUsed;   //only changed under the file lock
+} CacheHeader;
+
+//Slots are only ever filled, state is written last so readers need no lock
+typedef struct {
+	uint64_t key[2];
+	uint32_t state;
+	int32_t scoreBits, promoted;
+	int32_t queryStart, queryEnd, subjectStart, subjectEnd;
+	int32_t length, matches, editDistance;
+	int64_t score;
+	uint64_t cigarOffset;
+} CacheSlot;
+
+//Engine profile as read by loadProfile
+typedef struct {
+	int numEntries;
+	int threads[MAX_PROFILE_ENTRIES];
+	long cells[MAX_PROFILE_ENTRIES];   //crossover of each thread count, -1 for never
+	int blockHeight, blockWidth;       //0 without a tuned block size
+	omp_sched_t blockSchedule;
+	int blockChunk;
+} EngineProfile;
+
+void readFiles(char* queryFile, char* subjectFile);
+int parseMode(char* name);
+int scoresFitShort();
+int getScore(void* scoreMatrix, long index);
+void setScore(void* scoreMatrix, long index, int score);
+int initialize(void* scoreMatrix, int* tbMatrix, int flags);
+int fill16(short* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads);
+int fill32(int* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads);
+void fillXdrop(int* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads);
+int findEndPosition(void* scoreMatrix, int flags);
+void backtrack(int* tbMatrix, int endPos, char* cigarBuffer, Alignment* result);
+int prependCigarOp(char* cigar, int start, char op, int length);
+void writeResult(Alignment* result, double time, int numThreads);
+void printResults(Alignment* result, double time, int numThreads);
+void writeSam(Alignment* result);
+void writePaf(Alignment* result);
+void writeJson(Alignment* result);
+char* baseName(char* path);
+int openCache(char* path);
+void computeCacheKey(uint64_t key[2]);
+int cacheLookup(uint64_t key[2], Alignment* result);
+void cacheStore(uint64_t key[2], Alignment* result);
+int chooseEngine(EngineProfile* profile);
+long availableMemory();
+long tracebackBytes();
+void printMemoryEstimate();
+void* mapScratch(char* path, long bytes);
+double timeFill(int* scoreMatrix, int* tbMatrix, int flags, int thread_count);
+int calibrateEngines(char* profilePath);
+int loadProfile(char* profilePath, EngineProfile* profile);
+int tuneBlocks(char* profilePath);
+int writeProfile(char* profilePath, const char* key, const char* lines);
+int calcNumDiagRowElements(int i);
+void calcFirstDiagElement(int *i, int *start_i, int *start_j);
+int matchMismatchScore(int i, int j);
+int max(int x, int y);
+int min(int x, int y);
+
+//Default scores, can be overridden from the command line
+int matchScore = 2;
+int mismatchScore = -2;
+int gapScore = -5;
+//Cells scoring more than xdrop below the best score so far are pruned in xdrop mode
+int xdrop = 40;
+
+const char* modeNames[] = {"global", "local", "semiglobal", "overlap", "glocal", "xdrop"};
+const char* formatNames[] = {"text", "sam", "paf", "json"};
+//Free end gaps of each mode, local ignores ends and starts from any zero cell,
+//xdrop is anchored at the top left corner and ends at its best cell
+const int modeFlags[] = {
+	0,
+	FREE_QUERY_START | FREE_SUBJECT_START,
+	FREE_QUERY_START | FREE_QUERY_END | FREE_SUBJECT_START | FREE_SUBJECT_END,
+	FREE_QUERY_START | FREE_SUBJECT_END,
+	FREE_SUBJECT_START | FREE_SUBJECT_END,
+	0
+};
+
+int querySize = 0;
+int subjectSize = 0;
+int mode = GLOBAL;
+int outputFormat = TEXT;
+//Width of the score matrix, 16 bits unless -w 32 or the bounds on the scores say a
+//cell could leave their range. A 16 bit fill that saturates anyway is redone in 32 bits.
+int scoreBits = 16;
+int promoted = 0;
+//Score only runs skip the traceback matrix and report the end cell alone
+int scoreOnly = 0;
+long cellsComputed = 0;
+char* query, * subject;
+char* queryName, * subjectName;
+//Result cache mapped from -C, NULL without one
+char* cachePath = NULL;
+int cacheFd = -1;
+CacheHeader* cacheHeader = NULL;
+CacheSlot* cacheSlots;
+char* cacheHeap;
+int cacheStatus = CACHE_OFF;
+//Fill engine, picked from the matrix size and the core count when threads is auto
+const char* engineNames[] = {"serial", "wavefront", "blocked wavefront"};
+int engine = WAVEFRONT;
+int autoEngine = 0;
+//Block size and loop schedule of the blocked wavefront, taken from the profile
+int blockHeight = 0;
+int blockWidth = 0;
+omp_sched_t blockSchedule = omp_sched_static;
+int blockChunk = 1;
+const char* scheduleNames[] = {"", "static", "dynamic", "guided"};
+//Out of core runs keep both matrices in a memory mapped scratch file, the traceback
+//matrix in tiles of TILE_SIZE x TILE_SIZE cells
+int outOfCore = 0;
+char* scratchPath = NULL;
+long scratchBytes = 0;
+long tilesPerRow = 0;
+
+//Position of cell (i, j) in a tiled traceback matrix. Each tile is contiguous, so a
+//wavefront or a backtrack out of core works on a few pages of the file at a time.
+static inline long tileIndex(int i, int j) {
+	return (((long)(i >> TILE_SHIFT) * tilesPerRow + (j >> TILE_SHIFT)) << (2 * TILE_SHIFT))
+		+ ((i & TILE_MASK) << TILE_SHIFT) + (j & TILE_MASK);
+}
+
+static inline long tbIndex(int i, int j) {
+	return outOfCore ? tileIndex(i, j) : (long)subjectSize * i + j;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 5) {
+		printf("Please enter in this format: Align <query_file_name> <subject_file_name> <num_threads|auto|calibrate|tune> <global|local|semiglobal|overlap|glocal|xdrop> [-s match mismatch gap] [-x xdrop] [-f text|sam|paf|json] [-w 16|32] [-c] [-C cache_file] [-e engine_profile] [-m] [-o scratch_file]\n");
+		printf("\tthe engine profile is %s in the working directory unless -e names another file\n", ENGINE_PROFILE);
+		printf("\tauto picks the engine and thread count from the matrix size, calibrate times both engines on prefixes of the inputs and writes the profile auto reads\n");
+		printf("\ttune times block sizes and schedules of the wavefront on a prefix of the inputs and adds the fastest to the profile\n");
+		return 1;
+	}
+	char* queryFile = argv[1];
+	char* subjectFile = argv[2];
+	int thread_count = atoi(argv[3]);
+	autoEngine = strcmp(argv[3], "auto") == 0;
+	int calibrate = strcmp(argv[3], "calibrate") == 0;
+	int tune = strcmp(argv[3], "tune") == 0;
+	char* profilePath = ENGINE_PROFILE;
+	int estimateOnly = 0;
+	mode = parseMode(argv[4]);
+	if (mode < 0) {
+		printf("Unknown alignment mode: %s\n", argv[4]);
+		return 1;
+	}
+	for (int a = 5; a < argc; a++) {
+		if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+			matchScore = atoi(argv[++a]);
+			mismatchScore = atoi(argv[++a]);
+			gapScore = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-x") == 0 && a + 1 < argc) {
+			xdrop = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-c") == 0) {
+			scoreOnly = 1;
+		}
+		else if (strcmp(argv[a], "-C") == 0 && a + 1 < argc) {
+			cachePath = argv[++a];
+		}
+		else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			profilePath = argv[++a];
+		}
+		else if (strcmp(argv[a], "-m") == 0) {
+			estimateOnly = 1;
+		}
+		else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			outOfCore = 1;
+			scratchPath = argv[++a];
+		}
+		else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc) {
+			scoreBits = atoi(argv[++a]) == 32 ? 32 : 16;
+		}
+		else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			for (outputFormat = JSON; outputFormat > TEXT; outputFormat--) {
+				if (strcmp(argv[a + 1], formatNames[outputFormat]) == 0)
+					break;
+			}
+			a++;
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	if (scoreOnly && (outputFormat == SAM || outputFormat == PAF)) {
+		printf("Score only runs can only be written as text or json\n");
+		return 1;
+	}
+	readFiles(queryFile, subjectFile);
+	queryName = baseName(queryFile);
+	subjectName = baseName(subjectFile);
+	//results are written in few large blocks
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	//increment to add in 1 row and column
+	querySize++;
+	subjectSize++;
+	tilesPerRow = (subjectSize + TILE_MASK) >> TILE_SHIFT;
+	if ((long)querySize * subjectSize > INT_MAX) {
+		printf("Matrices over %d cells are not supported, %d x %d is too large\n", INT_MAX, querySize - 1, subjectSize - 1);
+		return 1;
+	}
+	if (estimateOnly) {
+		printMemoryEstimate();
+		return 0;
+	}
+	if (calibrate)
+		return calibrateEngines(profilePath) ? 0 : 1;
+	if (tune)
+		return tuneBlocks(profilePath) ? 0 : 1;
+	EngineProfile profile;
+	loadProfile(profilePath, &profile);
+	if (autoEngine)
+		thread_count = chooseEngine(&profile);
+	//a tuned block size replaces the cell by cell wavefront, X-drop keeps its own
+	if (engine == WAVEFRONT && mode != XDROP && profile.blockHeight > 0) {
+		blockHeight = profile.blockHeight;
+		blockWidth = profile.blockWidth;
+		blockSchedule = profile.blockSchedule;
+		blockChunk = profile.blockChunk;
+		engine = BLOCKED;
+	}
+
+	Alignment result;
+	uint64_t cacheKey[2];
+	if (cachePath && openCache(cachePath)) {
+		double lookupTime = omp_get_wtime();
+		computeCacheKey(cacheKey);
+		if (cacheLookup(cacheKey, &result)) {
+			cacheStatus = CACHE_HIT;
+			writeResult(&result, omp_get_wtime() - lookupTime, 0);
+			return 0;
+		}
+		cacheStatus = CACHE_MISS;
+	}
+
+	//X-drop marks pruned cells with NEG_INF, other modes stay in 16 bits when the
+	//bounds on the scores fit, so the fill is not run twice
+	int flags = modeFlags[mode];
+	if (mode == XDROP || !scoresFitShort())
+		scoreBits = 32;
+
+	//a run that would not fit in memory moves to a scratch file instead of swapping
+	long cells = (long)querySize * subjectSize;
+	long needed = cells * 4 + (scoreOnly ? 0 : cells * sizeof(int));
+	if (!outOfCore && needed > availableMemory()) {
+		fprintf(stderr, "%.1f MB needed but %.1f MB available, running out of core\n", needed / MB, availableMemory() / MB);
+		outOfCore = 1;
+	}
+
+	//allocate flattened score and traceback matrix, one row per query character
+	void *scoreMatrix;
+	int *tbMatrix;
+	if (outOfCore) {
+		//a 16 bit overflow would mean filling the file twice, start in 32 bits
+		scoreBits = 32;
+		long scoreBytes = (cells * sizeof(int) + 4095) & ~4095L;
+		scratchBytes = scoreBytes + (scoreOnly ? 0 : tracebackBytes());
+		scoreMatrix = mapScratch(scratchPath, scratchBytes);
+		tbMatrix = scoreOnly || !scoreMatrix ? NULL : (int*)((char*)scoreMatrix + scoreBytes);
+	}
+	else {
+		scoreMatrix = malloc(cells * (scoreBits / 8));
+		tbMatrix = scoreOnly ? NULL : malloc(cells * sizeof(int));
+	}
+	//every CIGAR operation covers at least one of the at most querySize + subjectSize columns
+	char* cigarBuffer = malloc(2 * (querySize + subjectSize));
+	if (!scoreMatrix || (!tbMatrix && !scoreOnly) || !cigarBuffer) {
+		printf("Unable to allocate matrices for %d x %d\n", querySize - 1, subjectSize - 1);
+		return 1;
+	}
+
+	//initialize variables
+	long int finalScore = 0;
+	int numThreads = 0;
+	int maxPosition = 0;
+	int overflow = initialize(scoreMatrix, tbMatrix, flags);
+
+	double initialTime = omp_get_wtime();
+
+	if (scoreBits == 16) {
+		if (overflow || fill16(scoreMatrix, tbMatrix, &maxPosition, thread_count, &numThreads)) {
+			//a first row or column score or a filled score saturated, rerun the whole
+			//alignment with 32 bit scores
+			free(scoreMatrix);
+			scoreBits = 32;
+			promoted = 1;
+			scoreMatrix = malloc(cells * sizeof(int));
+			if (!scoreMatrix) {
+				printf("Unable to allocate matrices for %d x %d\n", querySize - 1, subjectSize - 1);
+				return 1;
+			}
+			initialize(scoreMatrix, tbMatrix, flags);
+		}
+	}
+	if (scoreBits == 32) {
+		if (mode == XDROP)
+			fillXdrop(scoreMatrix, tbMatrix, &maxPosition, thread_count, &numThreads);
+		else
+			fill32(scoreMatrix, tbMatrix, &maxPosition, thread_count, &numThreads);
+	}
+	if (mode != LOCAL && mode != XDROP)
+		maxPosition = findEndPosition(scoreMatrix, flags);
+	finalScore = getScore(scoreMatrix, maxPosition);
+	if (scoreOnly) {
+		//only the end of the alignment is known without a traceback
+		memset(&result, 0, sizeof(Alignment));
+		result.cigar = "";
+		result.queryStart = result.subjectStart = -1;
+		result.queryEnd = maxPosition / subjectSize;
+		result.subjectEnd = maxPosition % subjectSize;
+	}
+	else {
+		backtrack(tbMatrix, maxPosition, cigarBuffer, &result);
+	}
+	result.score = finalScore;
+
+	double finalTime = omp_get_wtime();
+	double timeElapsed = finalTime - initialTime;
+	if (cacheStatus == CACHE_MISS)
+		cacheStore(cacheKey, &result);
+	writeResult(&result, timeElapsed, numThreads);
+	return 0;
+}
+
+int parseMode(char* name) {
+	for (int m = GLOBAL; m <= XDROP; m++) {
+		if (strcmp(name, modeNames[m]) == 0)
+			return m;
+	}
+	return -1;
+}
+
+//Bounds every cell of the matrix from the inputs alone. Cell (i, j) is at least the
+//score of a path of min(i, j) diagonal steps, each no worse than a mismatch or two
+//gaps, and |i - j| gaps, which includes the first row and column. That is lowest
+//either on the far end of the first row or column or in the bottom right corner.
+//It is at most the best diagonal step on every diagonal plus a positive gap score
+//on every step.
+int scoresFitShort() {
+	long shorter = min(querySize, subjectSize) - 1;
+	long longer = max(querySize, subjectSize) - 1;
+	long gap = min(gapScore, 0);
+	long worstStep = min(0, max(2 * gap, min(matchScore, mismatchScore)));
+	long lower = min(gap * longer, worstStep * shorter + gap * (longer - shorter));
+	long upper = max(max(matchScore, mismatchScore), 0) * shorter + max(gapScore, 0) * (shorter + longer);
+	//local cells never drop below 0
+	if (mode == LOCAL)
+		lower = 0;
+	return lower >= SHRT_MIN && upper <= SHRT_MAX;
+}
+
+//Scores outside the fill kernels are accessed through these so both widths share the code
+int getScore(void* scoreMatrix, long index) {
+	if (scoreBits == 16)
+		return ((short*)scoreMatrix)[index];
+	return ((int*)scoreMatrix)[index];
+}
+
+void setScore(void* scoreMatrix, long index, int score) {
+	if (scoreBits == 16)
+		((short*)scoreMatrix)[index] = score;
+	else
+		((int*)scoreMatrix)[index] = score;
+}
+
+//Returns 1 if a first row or column score does not fit the score width, the matrix
+//then has to be filled in 32 bits
+int initialize(void* scoreMatrix, int* tbMatrix, int flags) {
+	//only the first row and column are read before the fill writes them
+	long rowEnd = (flags & FREE_SUBJECT_START) ? 0 : (long)(subjectSize - 1) * gapScore;
+	long columnEnd = (flags & FREE_QUERY_START) ? 0 : (long)(querySize - 1) * gapScore;
+	int overflow = scoreBits == 16 && (rowEnd < SHRT_MIN || rowEnd > SHRT_MAX || columnEnd < SHRT_MIN || columnEnd > SHRT_MAX);
+	setScore(scoreMatrix, 0, 0);
+	for (int j = 1; j < subjectSize; j++)
+		setScore(scoreMatrix, j, (flags & FREE_SUBJECT_START) ? 0 : j * gapScore);
+	for (int i = 1; i < querySize; i++)
+		setScore(scoreMatrix, (long)subjectSize * i, (flags & FREE_QUERY_START) ? 0 : i * gapScore);
+	//score only runs have no traceback matrix
+	if (!tbMatrix)
+		return overflow;
+	tbMatrix[0] = NONE;
+	for (int j = 1; j < subjectSize; j++)
+		tbMatrix[tbIndex(0, j)] = (flags & FREE_SUBJECT_START) ? NONE : LEFT;
+	for (int i = 1; i < querySize; i++)
+		tbMatrix[tbIndex(i, 0)] = (flags & FREE_QUERY_START) ? NONE : UP;
+	return overflow;
+}
+
+//Fill kernels, AlignKernel.h is instantiated once for each score width
+#define SCORE_T short
+#define SCORE_BITS 16
+#define SCORE_MIN SHRT_MIN
+#define SCORE_MAX SHRT_MAX
+#define KERNEL(name) name##16
+#include "AlignKernel.h"
+
+#define SCORE_T int
+#define SCORE_BITS 32
+#define SCORE_MIN INT_MIN
+#define SCORE_MAX INT_MAX
+#define KERNEL(name) name##32
+#include "AlignKernel.h"
+
+//Reads a neighbour for X-drop, interior cells outside the rows visited on their
+//anti-diagonal were never written and count as pruned
+static inline int xdropCell(int* scoreMatrix, int i, int j, int lo, int hi) {
+	if (i == 0 || j == 0 || (i >= lo && i <= hi))
+		return scoreMatrix[(long)subjectSize * i + j];
+	return NEG_INF;
+}
+
+//Computes one cell for X-drop, lo1-hi1 and lo2-hi2 are the rows visited on the
+//previous two anti-diagonals and cells below cutoff are pruned
+static inline __attribute__((always_inline)) int xdropScore(int i, int j, int* scoreMatrix, int* tbMatrix, int cutoff, int lo1, int hi1, int lo2, int hi2, const int traceback) {
+	int up = xdropCell(scoreMatrix, i-1, j, lo1, hi1) + gapScore;
+	int left = xdropCell(scoreMatrix, i, j-1, lo1, hi1) + gapScore;
+	int diag = xdropCell(scoreMatrix, i-1, j-1, lo2, hi2) + matchMismatchScore(i, j);
+
+	int max = diag;
+	int pred = DIAG;
+	if (left > max) {
+		max = left;
+		pred = LEFT;
+	}
+	if (up > max) {
+		max = up;
+		pred = UP;
+	}
+	if (max < cutoff) {
+		max = NEG_INF;
+		pred = NONE;
+	}
+	long index = (long)subjectSize * i + j;
+	scoreMatrix[index] = max;
+	if (traceback)
+		tbMatrix[traceback == TB_TILES ? tileIndex(i, j) : index] = pred;
+	return max;
+}
+
+//Extension from the top left corner. Each anti-diagonal only visits the rows reachable
+//from live cells of the previous two and the fill stops after two anti-diagonals
+//in a row with none.
+//traceback is a constant at both call sites in fillXdrop, like in AlignKernel.h.
+static inline __attribute__((always_inline)) void fillXdropKernel(int* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads, const int traceback) {
+	int numDiag = querySize + subjectSize - 3;
+	int bestScore = 0;
+	int bestPos = 0;
+	//live rows of the previous two anti-diagonals including boundary cells, querySize/-1 when empty
+	int liveLo1 = 0, liveHi1 = 1;
+	int liveLo2 = 0, liveHi2 = 0;
+	//rows visited on the previous two anti-diagonals
+	int rowLo1 = querySize, rowHi1 = -1;
+	int rowLo2 = querySize, rowHi2 = -1;
+	int liveLo, liveHi, rowLo, rowHi, diagBest, diagPos, done = 0;
+	long cells = 0;
+	int start_i, start_j, numElements;
+
+	//boundary cells already more than X below the start can never be extended
+	for (int j = 1; j < subjectSize; j++) {
+		if (scoreMatrix[j] < -xdrop)
+			scoreMatrix[j] = NEG_INF;
+	}
+	for (int i = 1; i < querySize; i++) {
+		if (scoreMatrix[(long)subjectSize * i] < -xdrop)
+			scoreMatrix[(long)subjectSize * i] = NEG_INF;
+	}
+	if (subjectSize < 2 || scoreMatrix[1] == NEG_INF)
+		liveLo1 = 1;
+	if (querySize < 2 || scoreMatrix[subjectSize] == NEG_INF)
+		liveHi1 = 0;
+
+	#pragma omp parallel num_threads(thread_count) \
+	default(none) shared(scoreMatrix, tbMatrix, querySize, subjectSize, xdrop, numThreads, numDiag, bestScore, bestPos, \
+	liveLo1, liveHi1, liveLo2, liveHi2, rowLo1, rowHi1, rowLo2, rowHi2, liveLo, liveHi, rowLo, rowHi, diagBest, diagPos, done, cells, traceback) \
+	private(numElements, start_i, start_j)
+	{
+		*numThreads = omp_get_num_threads();
+		for (int i = 1; i <= numDiag && !done; i++) {
+			#pragma omp single
+			{
+				numElements = calcNumDiagRowElements(i);
+				calcFirstDiagElement(&i, &start_i, &start_j);
+				//a cell is reachable from the row above or the same row on the previous
+				//anti-diagonal, or from the row above on the one before
+				rowLo = max(min(liveLo1, liveLo2 + 1), start_i - numElements + 1);
+				rowHi = min(max(liveHi1 + 1, liveHi2 + 1), start_i);
+				liveLo = querySize;
+				liveHi = -1;
+				diagBest = NEG_INF;
+				diagPos = 0;
+			}
+			int cutoff = bestScore - xdrop;
+			int threadBest = NEG_INF;
+			int threadPos = 0;
+			#pragma omp for reduction(min:liveLo) reduction(max:liveHi) reduction(+:cells)
+			for (int row = rowLo; row <= rowHi; row++) {
+				int col = i + 1 - row;
+				int score = xdropScore(row, col, scoreMatrix, tbMatrix, cutoff, rowLo1, rowHi1, rowLo2, rowHi2, traceback);
+				if (score != NEG_INF) {
+					liveLo = min(liveLo, row);
+					liveHi = max(liveHi, row);
+					if (score > threadBest) {
+						threadBest = score;
+						threadPos = subjectSize * row + col;
+					}
+				}
+				cells++;
+			}
+			#pragma omp critical
+			if (threadBest > diagBest || (threadBest == diagBest && threadPos < diagPos)) {
+				diagBest = threadBest;
+				diagPos = threadPos;
+			}
+			#pragma omp barrier
+			#pragma omp single
+			{
+				//boundary cells of this anti-diagonal
+				if (i + 1 < subjectSize && scoreMatrix[i + 1] != NEG_INF)
+					liveLo = 0;
+				if (i + 1 < querySize && scoreMatrix[(long)subjectSize * (i + 1)] != NEG_INF)
+					liveHi = max(liveHi, i + 1);
+				if (diagBest > bestScore) {
+					bestScore = diagBest;
+					bestPos = diagPos;
+				}
+				liveLo2 = liveLo1;
+				liveHi2 = liveHi1;
+				liveLo1 = liveLo;
+				liveHi1 = liveHi;
+				rowLo2 = rowLo1;
+				rowHi2 = rowHi1;
+				rowLo1 = rowLo;
+				rowHi1 = rowHi;
+				//a diagonal step skips an anti-diagonal, so live cells on the previous
+				//one can still be extended past an empty one
+				if (liveHi1 < 0 && liveHi2 < 0)
+					done = 1;
+			}
+		}
+	}
+	*maxPos = bestPos;
+	cellsComputed = cells;
+}
+
+void fillXdrop(int* scoreMatrix, int* tbMatrix, int* maxPos, int thread_count, int* numThreads) {
+	if (tbMatrix && outOfCore)
+		fillXdropKernel(scoreMatrix, tbMatrix, maxPos, thread_count, numThreads, TB_TILES);
+	else if (tbMatrix)
+		fillXdropKernel(scoreMatrix, tbMatrix, maxPos, thread_count, numThreads, TB_ROWS);
+	else
+		fillXdropKernel(scoreMatrix, tbMatrix, maxPos, thread_count, numThreads, 0);
+}
+
+int findEndPosition(void* scoreMatrix, int flags) {
+	//bottom right corner unless the mode lets trailing gaps go unpenalized
+	int endPos = querySize * subjectSize - 1;
+	if (flags & FREE_QUERY_END) {
+		for (int i = 1; i < querySize; i++) {
+			int index = subjectSize * i + subjectSize - 1;
+			if (getScore(scoreMatrix, index) > getScore(scoreMatrix, endPos))
+				endPos = index;
+		}
+	}
+	if (flags & FREE_SUBJECT_END) {
+		for (int j = 1; j < subjectSize; j++) {
+			int index = subjectSize * (querySize - 1) + j;
+			if (getScore(scoreMatrix, index) > getScore(scoreMatrix, endPos))
+				endPos = index;
+		}
+	}
+	return endPos;
+}
+
+//Walks the traceback from endPos and writes the CIGAR from the back of cigarBuffer,
+//so it comes out in reading order without reversing anything
+void backtrack(int* tbMatrix, int endPos, char* cigarBuffer, Alignment* result) {
+	int cigarStart = 2 * (querySize + subjectSize) - 1;
+	int currPos = endPos;
+	char runOp = 0;
+	int runLength = 0;
+	result->length = 0;
+	result->matches = 0;
+	result->editDistance = 0;
+	cigarBuffer[cigarStart] = '\0';
+	//backtrack until reaching a cell the mode lets the alignment start from
+	while (1) {
+		int i = currPos / subjectSize;
+		int j = currPos % subjectSize;
+		int pred = tbMatrix[tbIndex(i, j)];
+		if (pred == NONE)
+			break;
+		char op;
+		if (pred == DIAG) { //diagonal
+			op = 'M';
+			if (query[i-1] == subject[j-1])
+				result->matches++;
+			else
+				result->editDistance++;
+			currPos -= subjectSize + 1;
+		}
+		else if (pred == UP) { //up, query base against a gap
+			op = 'I';
+			result->editDistance++;
+			currPos -= subjectSize;
+		}
+		else { //left, subject base against a gap
+			op = 'D';
+			result->editDistance++;
+			currPos -= 1;
+		}
+		if (op != runOp) {
+			cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+			runOp = op;
+			runLength = 0;
+		}
+		runLength++;
+		result->length++;
+	}
+	cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+	result->cigar = cigarBuffer + cigarStart;
+	result->queryStart = currPos / subjectSize;
+	result->subjectStart = currPos % subjectSize;
+	result->queryEnd = endPos / subjectSize;
+	result->subjectEnd = endPos % subjectSize;
+}
+
+int prependCigarOp(char* cigar, int start, char op, int length) {
+	if (length == 0)
+		return start;
+	cigar[--start] = op;
+	do {
+		cigar[--start] = '0' + length % 10;
+		length /= 10;
+	} while (length > 0);
+	return start;
+}
+
+void writeResult(Alignment* result, double time, int numThreads) {
+	if (outputFormat == SAM)
+		writeSam(result);
+	else if (outputFormat == PAF)
+		writePaf(result);
+	else if (outputFormat == JSON)
+		writeJson(result);
+	else
+		printResults(result, time, numThreads);
+}
+
+void printResults(Alignment* result, double time, int numThreads) {
+	//expand the CIGAR into the two strings and the bar marking matches, mismatches and gaps
+	int length = result->length;
+	char* qr = malloc(length + 1);
+	char* matchBar = malloc(length + 1);
+	char* sr = malloc(length + 1);
+	int i = result->queryStart;
+	int j = result->subjectStart;
+	int k = 0;
+	for (char* c = result->cigar; *c; ) {
+		int n = strtol(c, &c, 10);
+		char op = *c++;
+		while (n-- > 0) {
+			qr[k] = op == 'D' ? '-' : query[i++];
+			sr[k] = op == 'I' ? '-' : subject[j++];
+			if (op != 'M')
+				matchBar[k] = ' ';
+			else if (qr[k] == sr[k])
+				matchBar[k] = '|';
+			else
+				matchBar[k] = '*';
+			k++;
+		}
+	}
+	qr[length] = matchBar[length] = sr[length] = '\0';
+
+	printf("\n======================================\n");
+	printf("PROGRAM FINISHED\n");
+	printf("Analyzed query string of %d and subject string of %d in %s mode\n", querySize-1, subjectSize-1, modeNames[mode]);
+	printf("1) FINAL SCORE: %ld\n", result->score);
+	printf("2) ALIGNMENT STRING SIZE: %d\n", length);
+	printf("3) ALIGNMENT STRING:\n");
+	if (scoreOnly)
+		printf("\t(score only, no traceback)\n");
+	else
+		printf("\t%s\n\t%s\n\t%s\n", qr, matchBar, sr);
+	printf("4) TIME ELAPSED: %fs\n", time);
+	printf("5) NUMBER OF THREADS USED: %d\n", numThreads);
+	if (scoreOnly)
+		printf("6) QUERY END: %d SUBJECT END: %d\n", result->queryEnd, result->subjectEnd);
+	else
+		printf("6) QUERY RANGE: %d-%d SUBJECT RANGE: %d-%d\n", result->queryStart, result->queryEnd,
+			result->subjectStart, result->subjectEnd);
+	printf("7) CELLS COMPUTED: %ld (%.2f%% of matrix)\n", cellsComputed,
+		100.0 * cellsComputed / ((double)(querySize - 1) * (subjectSize - 1)));
+	printf("8) CIGAR: %s\n", length > 0 ? result->cigar : "*");
+	printf("9) SCORE WIDTH: %d bits%s\n", scoreBits, promoted ? " (promoted after 16 bit overflow)" : "");
+	if (cacheStatus != CACHE_OFF) {
+		const char* outcome[] = {"", "miss, not stored", "miss, stored", "hit"};
+		printf("10) RESULT CACHE: %s\n", outcome[cacheStatus]);
+	}
+	if (autoEngine)
+		printf("11) ENGINE: %s, chosen automatically for %d cores\n", engineNames[engine], omp_get_num_procs());
+	if (outOfCore)
+		printf("12) OUT OF CORE: %.1f MB scratch file%s%s\n", scratchBytes / MB, scratchPath ? " " : "", scratchPath ? scratchPath : "");
+	if (engine == BLOCKED)
+		printf("13) BLOCKS: %d x %d cells, %s schedule, chunk %d\n", blockHeight, blockWidth, scheduleNames[blockSchedule], blockChunk);
+	printf("======================================\n");
+	free(qr);
+	free(matchBar);
+	free(sr);
+}
+
+void writeSam(Alignment* result) {
+	printf("@HD\tVN:1.6\tSO:unsorted\n");
+	printf("@SQ\tSN:%s\tLN:%d\n", subjectName, subjectSize - 1);
+	printf("@PG\tID:Align\tPN:Align\tDS:%s\n", modeNames[mode]);
+	if (result->length == 0) {
+		printf("%s\t4\t*\t0\t0\t*\t*\t0\t0\t%.*s\t*\n", queryName, querySize - 1, query);
+		return;
+	}
+	//SAM places the query on the subject, deletions at either end only move POS
+	char* cigar = result->cigar;
+	int cigarLength = strlen(cigar);
+	int pos = result->subjectStart;
+	char* end;
+	int n = strtol(cigar, &end, 10);
+	if (*end == 'D') {
+		pos += n;
+		cigarLength -= end + 1 - cigar;
+		cigar = end + 1;
+	}
+	if (cigar[cigarLength - 1] == 'D') {
+		cigarLength--;
+		while (cigarLength > 0 && cigar[cigarLength - 1] >= '0' && cigar[cigarLength - 1] <= '9')
+			cigarLength--;
+	}
+	int clipStart = result->queryStart;
+	int clipEnd = querySize - 1 - result->queryEnd;
+	printf("%s\t0\t%s\t%d\t255\t", queryName, subjectName, pos + 1);
+	if (clipStart > 0)
+		printf("%dS", clipStart);
+	printf("%.*s", cigarLength, cigar);
+	if (clipEnd > 0)
+		printf("%dS", clipEnd);
+	printf("\t*\t0\t0\t%.*s\t*\tAS:i:%ld\tNM:i:%d\n", querySize - 1, query, result->score, result->editDistance);
+}
+
+void writePaf(Alignment* result) {
+	if (result->length == 0)
+		return;
+	printf("%s\t%d\t%d\t%d\t+\t%s\t%d\t%d\t%d\t%d\t%d\t255\tAS:i:%ld\tNM:i:%d\tcg:Z:%s\n",
+		queryName, querySize - 1, result->queryStart, result->queryEnd,
+		subjectName, subjectSize - 1, result->subjectStart, result->subjectEnd,
+		result->matches, result->length, result->score, result->editDistance, result->cigar);
+}
+
+void writeJson(Alignment* result) {
+	//one object per line so batches can be streamed
+	printf("{\"query\":\"%s\",\"subject\":\"%s\",\"mode\":\"%s\",\"score\":%ld,"
+		"\"query_start\":%d,\"query_end\":%d,\"subject_start\":%d,\"subject_end\":%d,"
+		"\"length\":%d,\"matches\":%d,\"edit_distance\":%d,\"cigar\":\"%s\"}\n",
+		queryName, subjectName, modeNames[mode], result->score,
+		result->queryStart, result->queryEnd, result->subjectStart, result->subjectEnd,
+		result->length, result->matches, result->editDistance, result->cigar);
+}
+
+char* baseName(char* path) {
+	char* slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+//MemAvailable from /proc/meminfo, free physical pages where it is missing
+long availableMemory() {
+	long available = -1;
+	FILE* fp = fopen("/proc/meminfo", "r");
+	if (fp) {
+		char line[256];
+		while (fgets(line, sizeof(line), fp)) {
+			if (sscanf(line, "MemAvailable: %ld kB", &available) == 1) {
+				available *= 1024;
+				break;
+			}
+		}
+		fclose(fp);
+	}
+	if (available < 0)
+		available = sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+	return available;
+}
+
+//Size of the tiled traceback matrix, whole tiles in both directions
+long tracebackBytes() {
+	long tileRows = (querySize + TILE_MASK) >> TILE_SHIFT;
+	return tileRows * tilesPerRow * TILE_SIZE * TILE_SIZE * sizeof(int);
+}
+
+void printMemoryEstimate() {
+	long cells = (long)querySize * subjectSize;
+	long tb = cells * sizeof(int);
+	//out of core only the tiles and score pages along a couple of anti-diagonals are hot
+	long band = (long)min(querySize, subjectSize);
+	long scratch = cells * 4 + tracebackBytes();
+	long resident = band / TILE_SIZE * 2 * TILE_SIZE * TILE_SIZE * sizeof(int) + band * 3 * sysconf(_SC_PAGESIZE);
+	if (resident > scratch)
+		resident = scratch;
+	printf("\n======================================\n");
+	printf("MEMORY ESTIMATE\n");
+	printf("Query string of %d and subject string of %d in %s mode\n", querySize - 1, subjectSize - 1, modeNames[mode]);
+	printf("1) WAVEFRONT WITH TRACEBACK: %.1f MB in 16 bits, %.1f MB in 32 bits\n",
+		(cells * 2 + tb) / MB, (cells * 4 + tb) / MB);
+	printf("2) SCORE ONLY (-c): %.1f MB in 16 bits, %.1f MB in 32 bits\n", cells * 2 / MB, cells * 4 / MB);
+	printf("3) OUT OF CORE (-o): %.1f MB scratch file, about %.1f MB resident\n",
+		scratch / MB, resident / MB);
+	printf("4) AVAILABLE MEMORY: %.1f MB\n", availableMemory() / MB);
+	printf("======================================\n");
+}
+
+//Maps a scratch file of the given size at path, or a temporary one when path is
+//NULL. The pages are written back to the file, not to swap.
+void* mapScratch(char* path, long bytes) {
+	int fd;
+	if (path) {
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	}
+	else {
+		const char* dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+		char* temp = malloc(strlen(dir) + 32);
+		sprintf(temp, "%s/alignScratchXXXXXX", dir);
+		fd = mkstemp(temp);
+		path = temp;
+	}
+	//the mapping keeps the file alive, nothing is left behind however the run ends
+	if (fd >= 0)
+		unlink(path);
+	if (path != scratchPath)
+		free(path);
+	if (fd < 0 || ftruncate(fd, bytes) != 0) {
+		fprintf(stderr, "Unable to create a %.1f MB scratch file\n", bytes / MB);
+		return NULL;
+	}
+	void* base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	return base == MAP_FAILED ? NULL : base;
+}
+
+//Maps the cache file, creating and sizing it on first use. Returns 0 and runs
+//without a cache if it cannot be used.
+int openCache(char* path) {
+	long size = sizeof(CacheHeader) + (long)CACHE_SLOTS * sizeof(CacheSlot) + CACHE_HEAP;
+	cacheFd = open(path, O_RDWR | O_CREAT, 0644);
+	if (cacheFd < 0) {
+		fprintf(stderr, "Unable to open cache %s, running without it\n", path);
+		return 0;
+	}
+	//only one process lays out a new file
+	flock(cacheFd, LOCK_EX);
+	if (lseek(cacheFd, 0, SEEK_END) < size && ftruncate(cacheFd, size) != 0) {
+		flock(cacheFd, LOCK_UN);
+		fprintf(stderr, "Unable to size cache %s, running without it\n", path);
+		return 0;
+	}
+	void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, cacheFd, 0);
+	if (base == MAP_FAILED) {
+		flock(cacheFd, LOCK_UN);
+		fprintf(stderr, "Unable to map cache %s, running without it\n", path);
+		return 0;
+	}
+	cacheHeader = base;
+	cacheSlots = (CacheSlot*)(cacheHeader + 1);
+	cacheHeap = (char*)(cacheSlots + CACHE_SLOTS);
+	if (cacheHeader->magic != CACHE_MAGIC) {
+		//the file is new and reads as zeros, every slot is already empty
+		cacheHeader->numSlots = CACHE_SLOTS;
+		cacheHeader->heapSize = CACHE_HEAP;
+		cacheHeader->heapUsed = 0;
+		__atomic_store_n(&cacheHeader->magic, CACHE_MAGIC, __ATOMIC_RELEASE);
+	}
+	flock(cacheFd, LOCK_UN);
+	if (cacheHeader->numSlots != CACHE_SLOTS || cacheHeader->heapSize != CACHE_HEAP) {
+		fprintf(stderr, "Cache %s has a different layout, running without it\n", path);
+		return 0;
+	}
+	return 1;
+}
+
+//128 bit key over both sequences and every parameter that changes the result, two
+//FNV-1a hashes with different seeds finished by a 64 bit mixer
+static inline uint64_t hashBytes(uint64_t h, const void* data, long length) {
+	const unsigned char* p = data;
+	for (long k = 0; k < length; k++) {
+		h ^= p[k];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static inline uint64_t mix64(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+void computeCacheKey(uint64_t key[2]) {
+	int params[8] = {mode, matchScore, mismatchScore, gapScore, mode == XDROP ? xdrop : 0, scoreOnly,
+		querySize - 1, subjectSize - 1};
+	uint64_t seeds[2] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL};
+	for (int k = 0; k < 2; k++) {
+		uint64_t h = hashBytes(seeds[k], params, sizeof(params));
+		h = hashBytes(h, query, querySize - 1);
+		h = hashBytes(h, subject, subjectSize - 1);
+		key[k] = mix64(h);
+	}
+}
+
+int cacheLookup(uint64_t key[2], Alignment* result) {
+	for (int probe = 0; probe < CACHE_PROBES; probe++) {
+		CacheSlot* slot = &cacheSlots[(key[0] + probe) & (CACHE_SLOTS - 1)];
+		if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != SLOT_READY)
+			return 0;
+		if (slot->key[0] != key[0] || slot->key[1] != key[1])
+			continue;
+		result->score = slot->score;
+		result->queryStart = slot->queryStart;
+		result->queryEnd = slot->queryEnd;
+		result->subjectStart = slot->subjectStart;
+		result->subjectEnd = slot->subjectEnd;
+		result->length = slot->length;
+		result->matches = slot->matches;
+		result->editDistance = slot->editDistance;
+		result->cigar = cacheHeap + slot->cigarOffset;
+		scoreBits = slot->scoreBits;
+		promoted = slot->promoted;
+		return 1;
+	}
+	return 0;
+}
+
+void cacheStore(uint64_t key[2], Alignment* result) {
+	long cigarLength = strlen(result->cigar) + 1;
+	flock(cacheFd, LOCK_EX);
+	for (int probe = 0; probe < CACHE_PROBES; probe++) {
+		CacheSlot* slot = &cacheSlots[(key[0] + probe) & (CACHE_SLOTS - 1)];
+		if (slot->state == SLOT_READY) {
+			if (slot->key[0] == key[0] && slot->key[1] == key[1]) {
+				//another process stored it first
+				cacheStatus = CACHE_STORED;
+				break;
+			}
+			continue;
+		}
+		if (cacheHeader->heapUsed + cigarLength > cacheHeader->heapSize)
+			break;
+		slot->cigarOffset = cacheHeader->heapUsed;
+		memcpy(cacheHeap + slot->cigarOffset, result->cigar, cigarLength);
+		cacheHeader->heapUsed += cigarLength;
+		slot->key[0] = key[0];
+		slot->key[1] = key[1];
+		slot->scoreBits = scoreBits;
+		slot->promoted = promoted;
+		slot->queryStart = result->queryStart;
+		slot->queryEnd = result->queryEnd;
+		slot->subjectStart = result->subjectStart;
+		slot->subjectEnd = result->subjectEnd;
+		slot->length = result->length;
+		slot->matches = result->matches;
+		slot->editDistance = result->editDistance;
+		slot->score = result->score;
+		__atomic_store_n(&slot->state, SLOT_READY, __ATOMIC_RELEASE);
+		cacheStatus = CACHE_STORED;
+		break;
+	}
+	flock(cacheFd, LOCK_UN);
+}
+
+//Picks the largest thread count whose crossover in the profile the matrix reaches,
+//and falls back to the serial engine below all of them. Returns the thread count.
+int chooseEngine(EngineProfile* profile) {
+	long cells = (long)(querySize - 1) * (subjectSize - 1);
+	int threads = 1;
+	for (int k = 0; k < profile->numEntries; k++) {
+		//a negative crossover means the thread count never won during calibration
+		if (profile->cells[k] >= 0 && cells >= profile->cells[k] && profile->threads[k] > threads
+			&& profile->threads[k] <= omp_get_num_procs())
+			threads = profile->threads[k];
+	}
+	//X-drop has no serial engine, its wavefront simply runs on one thread
+	engine = threads > 1 || mode == XDROP ? WAVEFRONT : SERIAL;
+	return threads;
+}
+
+//Best of three 32 bit fills with the current engine, the first run also faults the
+//pages in
+double timeFill(int* scoreMatrix, int* tbMatrix, int flags, int thread_count) {
+	int maxPosition, numThreads;
+	double best = 1e30;
+	for (int r = 0; r < 3; r++) {
+		initialize(scoreMatrix, tbMatrix, flags);
+		double t0 = omp_get_wtime();
+		fill32(scoreMatrix, tbMatrix, &maxPosition, thread_count, &numThreads);
+		double t = omp_get_wtime() - t0;
+		if (t < best)
+			best = t;
+	}
+	return best;
+}
+
+//Times the serial engine against the wavefront at every power of two thread count
+//up to the core count, on square prefixes of the inputs doubling from CALIBRATE_MIN.
+//A thread count's crossover is the smallest size from which it beat the serial
+//engine at every larger size tried.
+int calibrateEngines(char* profilePath) {
+	int counts[MAX_PROFILE_ENTRIES];
+	long crossover[MAX_PROFILE_ENTRIES];
+	int numCounts = 0;
+	for (int t = 2; t <= omp_get_num_procs() && numCounts < MAX_PROFILE_ENTRIES; t *= 2) {
+		counts[numCounts] = t;
+		crossover[numCounts++] = -1;
+	}
+	int largest = min(querySize, subjectSize) - 1;
+	if (largest < CALIBRATE_MIN) {
+		printf("Calibration needs inputs of at least %d characters\n", CALIBRATE_MIN);
+		return 0;
+	}
+	int* scoreMatrix = malloc((long)(largest + 1) * (largest + 1) * sizeof(int));
+	int* tbMatrix = malloc((long)(largest + 1) * (largest + 1) * sizeof(int));
+	if (!scoreMatrix || !tbMatrix) {
+		printf("Unable to allocate matrices for %d x %d\n", largest, largest);
+		return 0;
+	}
+	int flags = modeFlags[mode];
+	//the prefixes are filled in memory with a row major traceback, -o only applies
+	//to real runs, so the sizes and layout of the inputs are put back afterwards
+	int savedQuery = querySize, savedSubject = subjectSize;
+	int savedOutOfCore = outOfCore, savedEngine = engine;
+	outOfCore = 0;
+
+	printf("\n======================================\n");
+	printf("CALIBRATING %s mode on %d cores\n", modeNames[mode], omp_get_num_procs());
+	for (int n = CALIBRATE_MIN; n <= largest; n *= 2) {
+		querySize = subjectSize = n + 1;
+		engine = SERIAL;
+		double serialTime = timeFill(scoreMatrix, tbMatrix, flags, 1);
+		printf("%d x %d: serial %fs", n, n, serialTime);
+		engine = WAVEFRONT;
+		for (int k = 0; k < numCounts; k++) {
+			double waveTime = timeFill(scoreMatrix, tbMatrix, flags, counts[k]);
+			printf(", %d threads %fs", counts[k], waveTime);
+			if (waveTime >= serialTime)
+				crossover[k] = -1;
+			else if (crossover[k] < 0)
+				crossover[k] = (long)n * n;
+		}
+		printf("\n");
+	}
+	free(scoreMatrix);
+	free(tbMatrix);
+	querySize = savedQuery;
+	subjectSize = savedSubject;
+	outOfCore = savedOutOfCore;
+	engine = savedEngine;
+
+	char lines[MAX_PROFILE_ENTRIES * 64 + 128];
+	int length = sprintf(lines, "#threads: cells from which each thread count beats the serial engine, -1 for never\n");
+	for (int k = 0; k < numCounts; k++)
+		length += sprintf(lines + length, "threads %d cells %ld\n", counts[k], crossover[k]);
+	if (!writeProfile(profilePath, "threads", lines))
+		return 0;
+	printf("Profile written to %s\n", profilePath);
+	printf("======================================\n");
+	return 1;
+}
+
+//Reads the crossover cells of each thread count and the block line of the profile.
+//Without threads lines a thread count is assumed to pay off from
+//DEFAULT_CELLS_PER_THREAD cells per thread, without a block line, or with a height
+//of 0 because tune found the cell by cell wavefront fastest, blockHeight stays 0.
+//Returns 0 if the file could not be read.
+int loadProfile(char* profilePath, EngineProfile* profile) {
+	memset(profile, 0, sizeof(EngineProfile));
+	profile->blockSchedule = omp_sched_static;
+	profile->blockChunk = 1;
+	FILE* fp = fopen(profilePath, "r");
+	int found = fp != NULL;
+	if (fp) {
+		char line[256], schedule[16];
+		int height, width, chunk;
+		while (fgets(line, sizeof(line), fp)) {
+			int k = profile->numEntries;
+			if (k < MAX_PROFILE_ENTRIES && sscanf(line, "threads %d cells %ld", &profile->threads[k], &profile->cells[k]) == 2)
+				profile->numEntries++;
+			else if (sscanf(line, "block %d %d schedule %15s chunk %d", &height, &width, schedule, &chunk) == 4
+				&& height > 0 && width > 0) {
+				profile->blockHeight = height;
+				profile->blockWidth = width;
+				profile->blockChunk = max(chunk, 1);
+				for (int s = 1; s <= NUM_SCHEDULES; s++) {
+					if (strcmp(schedule, scheduleNames[s]) == 0)
+						profile->blockSchedule = s;
+				}
+			}
+		}
+		fclose(fp);
+	}
+	if (profile->numEntries == 0) {
+		for (int t = 2; t <= omp_get_num_procs() && profile->numEntries < MAX_PROFILE_ENTRIES; t *= 2) {
+			profile->threads[profile->numEntries] = t;
+			profile->cells[profile->numEntries++] = t * DEFAULT_CELLS_PER_THREAD;
+		}
+	}
+	return found;
+}
+
+//Times the cell by cell wavefront and every block size and schedule on a square
+//prefix of the inputs of at most TUNE_MAX, with one thread per core. The fastest
+//goes in the block line of the profile.
+int tuneBlocks(char* profilePath) {
+	const int heights[NUM_BLOCK_SIZES] = {16, 32, 64, 128, 256};
+	const int widths[NUM_BLOCK_SIZES] = {64, 128, 256, 512, 1024};
+	int n = min(min(querySize, subjectSize) - 1, TUNE_MAX);
+	if (n < CALIBRATE_MIN) {
+		printf("Tuning needs inputs of at least %d characters\n", CALIBRATE_MIN);
+		return 0;
+	}
+	int* scoreMatrix = malloc((long)(n + 1) * (n + 1) * sizeof(int));
+	int* tbMatrix = malloc((long)(n + 1) * (n + 1) * sizeof(int));
+	if (!scoreMatrix || !tbMatrix) {
+		printf("Unable to allocate matrices for %d x %d\n", n, n);
+		return 0;
+	}
+	int thread_count = omp_get_num_procs();
+	int flags = modeFlags[mode];
+	//the prefix is filled in memory with a row major traceback, -o only applies to
+	//real runs, so the sizes, layout and blocks in use are put back afterwards
+	int savedQuery = querySize, savedSubject = subjectSize;
+	int savedOutOfCore = outOfCore, savedEngine = engine;
+	int savedHeight = blockHeight, savedWidth = blockWidth;
+	omp_sched_t savedSchedule = blockSchedule;
+	outOfCore = 0;
+	querySize = subjectSize = n + 1;
+
+	printf("\n======================================\n");
+	printf("TUNING %s mode on %d x %d with %d threads\n", modeNames[mode], n, n, thread_count);
+	//block height 0 stands for the cell by cell wavefront, the time to beat
+	int bestHeight = 0, bestWidth = 0, bestSchedule = omp_sched_static;
+	engine = WAVEFRONT;
+	double bestTime = timeFill(scoreMatrix, tbMatrix, flags, thread_count);
+	printf("cell wavefront: %fs\n", bestTime);
+	engine = BLOCKED;
+	for (int h = 0; h < NUM_BLOCK_SIZES; h++) {
+		for (int w = 0; w < NUM_BLOCK_SIZES; w++) {
+			for (int k = 1; k <= NUM_SCHEDULES; k++) {
+				blockHeight = heights[h];
+				blockWidth = widths[w];
+				blockSchedule = k;
+				double time = timeFill(scoreMatrix, tbMatrix, flags, thread_count);
+				printf("%d x %d %s: %fs\n", blockHeight, blockWidth, scheduleNames[k], time);
+				if (time < bestTime) {
+					bestTime = time;
+					bestHeight = blockHeight;
+					bestWidth = blockWidth;
+					bestSchedule = k;
+				}
+			}
+		}
+	}
+	free(scoreMatrix);
+	free(tbMatrix);
+	querySize = savedQuery;
+	subjectSize = savedSubject;
+	outOfCore = savedOutOfCore;
+	engine = savedEngine;
+	blockHeight = savedHeight;
+	blockWidth = savedWidth;
+	blockSchedule = savedSchedule;
+
+	char lines[256];
+	sprintf(lines, "#block: height, width and schedule of the blocked wavefront, height 0 for the cell wavefront\n"
+		"block %d %d schedule %s chunk %d\n", bestHeight, bestWidth, scheduleNames[bestSchedule], 1);
+	if (!writeProfile(profilePath, "block", lines))
+		return 0;
+	if (bestHeight > 0)
+		printf("Fastest: %d x %d blocks, %s schedule, %fs\n", bestHeight, bestWidth, scheduleNames[bestSchedule], bestTime);
+	else
+		printf("Fastest: cell wavefront, %fs\n", bestTime);
+	printf("Profile written to %s\n", profilePath);
+	printf("======================================\n");
+	return 1;
+}
+
+//Replaces the lines of the profile that start with key, or with #key for their
+//comment, and keeps what calibrate or tune wrote for the others
+int writeProfile(char* profilePath, const char* key, const char* lines) {
+	char kept[4096];
+	int length = 0;
+	int keyLength = strlen(key);
+	FILE* fp = fopen(profilePath, "r");
+	if (fp) {
+		char line[256];
+		while (fgets(line, sizeof(line), fp)) {
+			if (strncmp(line, key, keyLength) == 0 || (line[0] == '#' && strncmp(line + 1, key, keyLength) == 0))
+				continue;
+			if (length + strlen(line) < sizeof(kept))
+				length += sprintf(kept + length, "%s", line);
+		}
+		fclose(fp);
+	}
+	fp = fopen(profilePath, "w");
+	if (!fp) {
+		printf("Unable to write %s\n", profilePath);
+		return 0;
+	}
+	fprintf(fp, "%.*s%s", length, kept, lines);
+	fclose(fp);
+	return 1;
+}
+
+int calcNumDiagRowElements(int i) {
+	if (i < querySize && i < subjectSize) {
+		//Number of elements in the diagonal is increasing
+		return i;
+	}
+	else if (i < max(querySize, subjectSize)) {
+		//Number of elements in the diagonal is stable
+		int size = min(querySize, subjectSize);
+		return size - 1;
+	}
+	else {
+		//Number of elements in the diagonal is decreasing
+		int size = min(querySize, subjectSize);
+		return 2 * size - i + abs(querySize - subjectSize) - 2;
+	}
+}
+
+void calcFirstDiagElement(int *i, int *start_i, int *start_j) {
+	// Calculate the first element of diagonal
+	if (*i < querySize) {
+		*start_i = *i;
+		*start_j = 1;
+	} else {
+		*start_i = querySize - 1;
+		*start_j = *i - querySize + 2;
+	}
+}
+
+int matchMismatchScore(int i, int j) {
+	if (query[i-1] == subject[j-1])
+		return matchScore;
+	else
+		return mismatchScore;
+}
+
+int max(int x, int y) {
+	if (x > y)
+		return x;
+	else
+		return y;
+}
+
+int min(int x, int y) {
+	if (x > y)
+		return y;
+	else
+		return x;
+}
+
+void readFiles(char* queryFile, char* subjectFile) {
+	FILE* qfp = fopen(queryFile, "r");
+	FILE* sfp = fopen(subjectFile, "r");
+
+	if (qfp) {
+		fseek(qfp, 0, SEEK_END);
+		querySize = ftell(qfp);
+		fseek(qfp, 0, SEEK_SET);
+		query = malloc(querySize);
+		if (query) {
+			fread(query, 1, querySize, qfp);
+		}
+		fclose(qfp);
+	}
+
+	if (sfp) {
+		fseek(sfp, 0, SEEK_END);
+		subjectSize = ftell(sfp);
+		fseek(sfp, 0, SEEK_SET);
+		subject = malloc(subjectSize);
+		if (subject) {
+			fread(subject, 1, subjectSize, sfp);
+		}
+		fclose(sfp);
+	}
+}
@@ -0,0 +1,631 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <omp.h>
+
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//Define alignment modes
+#define GLOBAL 0
+#define LOCAL 1
+#define SEMIGLOBAL 2
+#define OVERLAP 3
+#define GLOCAL 4
+//Define free end gap flags, rows of the matrix are the query and columns the subject
+#define FREE_QUERY_START 1
+#define FREE_QUERY_END 2
+#define FREE_SUBJECT_START 4
+#define FREE_SUBJECT_END 8
+//Define output formats
+#define PAF 0
+#define JSON 1
+//Slots in each queue between two stages, rounded up to a power of two
+#define DEFAULT_QUEUE_SIZE 64
+//Reader and writer threads, every other thread aligns
+#define IO_THREADS 2
+
+typedef struct {
+	char* name;
+	char* seq;
+	int length;
+} Record;
+
+//One pair travelling through the pipeline, filled in by the worker that aligns it
+typedef struct {
+	long int number;
+	Record query, subject;
+	long int score;
+	int queryStart, queryEnd, subjectStart, subjectEnd;   //0 based, half open
+	int length, matches, editDistance;
+	char* cigar;
+} Job;
+
+//Bounded multi-producer multi-consumer queue. Every slot carries a sequence number
+//telling producers and consumers whose turn it is, so no locks are taken.
+typedef struct {
+	atomic_size_t sequence;
+	Job* job;
+} QueueSlot;
+
+typedef struct {
+	QueueSlot* slots;
+	size_t mask;
+	char pad1[64];
+	atomic_size_t head;   //next slot to fill
+	char pad2[64];
+	atomic_size_t tail;   //next slot to take
+	char pad3[64];
+} Queue;
+
+//Streaming FASTA reader, the header of the next record is read ahead
+typedef struct {
+	FILE* fp;
+	char* fileName;
+	char* line;
+	size_t lineCap;
+	int pending;   //line holds the header of the next record
+	int started;
+} FastaReader;
+
+int parseMode(char* name);
+int queueInit(Queue* q, size_t size);
+int queueTryPush(Queue* q, Job* job);
+int queueTryPop(Queue* q, Job** job);
+void queuePush(Queue* q, Job* job);
+Job* queuePop(Queue* q);
+int openFasta(FastaReader* reader, char* path);
+int readRecord(FastaReader* reader, Record* record);
+void runReader(FastaReader* queries, FastaReader* subjects, Queue* jobs, int numWorkers);
+void runWorker(Queue* jobs, Queue* results);
+void runWriter(Queue* results, int numWorkers, long int* numPairs, long int* numCells);
+void alignPair(Job* job, char** tbBuffer, long* tbCapacity, int** rowBuffer, int* rowCapacity);
+int prependCigarOp(char* cigar, int start, char op, int length);
+void writePaf(Job* job);
+void writeJson(Job* job);
+void freeJob(Job* job);
+char* baseName(char* path);
+
+//Default scores, can be overridden from the command line
+int matchScore = 2;
+int mismatchScore = -2;
+int gapScore = -5;
+
+const char* modeNames[] = {"global", "local", "semiglobal", "overlap", "glocal"};
+const char* formatNames[] = {"paf", "json"};
+//Free end gaps of each mode, same meaning as in Align_Omp
+const int modeFlags[] = {
+	0,
+	FREE_QUERY_START | FREE_SUBJECT_START,
+	FREE_QUERY_START | FREE_QUERY_END | FREE_SUBJECT_START | FREE_SUBJECT_END,
+	FREE_QUERY_START | FREE_SUBJECT_END,
+	FREE_SUBJECT_START | FREE_SUBJECT_END
+};
+
+int mode = GLOBAL;
+int outputFormat = PAF;
+
+int main(int argc, char* argv[]) {
+	if (argc < 5) {
+		printf("Please enter in this format: Align_Pipeline <query_fasta> <subject_fasta> <num_workers> <global|local|semiglobal|overlap|glocal> [-s match mismatch gap] [-f paf|json] [-q queue_size]\n");
+		printf("\tthe n-th query record is aligned with the n-th subject record, results are written as they finish\n");
+		return 1;
+	}
+	int numWorkers = atoi(argv[3]);
+	int queueSize = DEFAULT_QUEUE_SIZE;
+	mode = parseMode(argv[4]);
+	if (mode < 0) {
+		printf("Unknown alignment mode: %s\n", argv[4]);
+		return 1;
+	}
+	for (int a = 5; a < argc; a++) {
+		if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+			matchScore = atoi(argv[++a]);
+			mismatchScore = atoi(argv[++a]);
+			gapScore = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-q") == 0 && a + 1 < argc) {
+			queueSize = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			for (outputFormat = JSON; outputFormat > PAF; outputFormat--) {
+				if (strcmp(argv[a + 1], formatNames[outputFormat]) == 0)
+					break;
+			}
+			a++;
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	if (numWorkers < 1)
+		numWorkers = 1;
+	if (queueSize < 2)
+		queueSize = 2;
+
+	FastaReader queries, subjects;
+	if (!openFasta(&queries, argv[1]) || !openFasta(&subjects, argv[2])) {
+		printf("Unable to open %s or %s\n", argv[1], argv[2]);
+		return 1;
+	}
+	//results are written in few large blocks
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	Queue jobs, results;
+	if (!queueInit(&jobs, queueSize) || !queueInit(&results, queueSize)) {
+		printf("Unable to allocate queues of %d slots\n", queueSize);
+		return 1;
+	}
+	long int numPairs = 0;
+	long int numCells = 0;
+	int numThreads = 0;
+
+	double initialTime = omp_get_wtime();
+
+	//every stage needs its own thread, do not let the runtime hand out fewer
+	omp_set_dynamic(0);
+	#pragma omp parallel num_threads(numWorkers + IO_THREADS) \
+	default(none) shared(queries, subjects, jobs, results, numPairs, numCells, numThreads)
+	{
+		//the runtime may still grant fewer threads than asked, for example under a
+		//thread limit or when nested, so the workers and their end markers are
+		//counted from the threads that are actually running
+		int id = omp_get_thread_num();
+		int granted = omp_get_num_threads();
+		#pragma omp single nowait
+		numThreads = granted;
+		if (granted > IO_THREADS) {
+			if (id == 0)
+				runReader(&queries, &subjects, &jobs, granted - IO_THREADS);
+			else if (id == 1)
+				runWriter(&results, granted - IO_THREADS, &numPairs, &numCells);
+			else
+				runWorker(&jobs, &results);
+		}
+	}
+	if (numThreads <= IO_THREADS) {
+		printf("Only %d threads granted, the pipeline needs at least %d\n", numThreads, IO_THREADS + 1);
+		return 1;
+	}
+
+	double timeElapsed = omp_get_wtime() - initialTime;
+	fflush(stdout);
+	//stdout carries the alignments, the summary goes to stderr
+	fprintf(stderr, "\n======================================\n");
+	fprintf(stderr, "PROGRAM FINISHED\n");
+	fprintf(stderr, "Aligned %ld pairs in %s mode\n", numPairs, modeNames[mode]);
+	fprintf(stderr, "1) CELLS COMPUTED: %ld\n", numCells);
+	fprintf(stderr, "2) TIME ELAPSED: %fs\n", timeElapsed);
+	fprintf(stderr, "3) GCUPS: %f\n", timeElapsed > 0 ? numCells / timeElapsed / 1e9 : 0.0);
+	fprintf(stderr, "4) NUMBER OF THREADS USED: %d (1 reader, %d workers, 1 writer)\n", numThreads, numThreads - IO_THREADS);
+	fprintf(stderr, "======================================\n");
+	return 0;
+}
+
+int parseMode(char* name) {
+	for (int m = GLOBAL; m <= GLOCAL; m++) {
+		if (strcmp(name, modeNames[m]) == 0)
+			return m;
+	}
+	return -1;
+}
+
+//Returns 0 when out of memory
+int queueInit(Queue* q, size_t size) {
+	size_t capacity = 1;
+	while (capacity < size)
+		capacity <<= 1;
+	q->slots = malloc(capacity * sizeof(QueueSlot));
+	if (!q->slots)
+		return 0;
+	q->mask = capacity - 1;
+	for (size_t s = 0; s < capacity; s++)
+		atomic_init(&q->slots[s].sequence, s);
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+	return 1;
+}
+
+int queueTryPush(Queue* q, Job* job) {
+	size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+	QueueSlot* slot;
+	for (;;) {
+		slot = &q->slots[pos & q->mask];
+		size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			//slot is free for this position, claim it
+			if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0) {
+			//the consumer of the previous lap has not taken it yet, queue is full
+			return 0;
+		}
+		else {
+			pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+		}
+	}
+	slot->job = job;
+	atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+	return 1;
+}
+
+int queueTryPop(Queue* q, Job** job) {
+	size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	QueueSlot* slot;
+	for (;;) {
+		slot = &q->slots[pos & q->mask];
+		size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0) {
+			//nothing published in this slot yet, queue is empty
+			return 0;
+		}
+		else {
+			pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+		}
+	}
+	*job = slot->job;
+	//hand the slot to the producer of the next lap
+	atomic_store_explicit(&slot->sequence, pos + q->mask + 1, memory_order_release);
+	return 1;
+}
+
+//Blocking wrappers, a full or empty queue gives the core to another stage
+void queuePush(Queue* q, Job* job) {
+	while (!queueTryPush(q, job))
+		sched_yield();
+}
+
+Job* queuePop(Queue* q) {
+	Job* job;
+	while (!queueTryPop(q, &job))
+		sched_yield();
+	return job;
+}
+
+int openFasta(FastaReader* reader, char* path) {
+	reader->fp = fopen(path, "r");
+	reader->fileName = baseName(path);
+	reader->line = NULL;
+	reader->lineCap = 0;
+	reader->pending = 0;
+	reader->started = 0;
+	return reader->fp != NULL;
+}
+
+//Reads the next record, a file without a header line is one record named after the
+//file. Running out of memory ends the program, the pairs already queued are lost.
+int readRecord(FastaReader* reader, Record* record) {
+	ssize_t n;
+	if (!reader->pending) {
+		if (reader->started)
+			return 0;
+		//skip blank lines before the first record
+		do {
+			n = getline(&reader->line, &reader->lineCap, reader->fp);
+		} while (n > 0 && (reader->line[0] == '\n' || reader->line[0] == '\r'));
+		if (n <= 0)
+			return 0;
+		reader->started = 1;
+		reader->pending = 1;
+	}
+	int seqCap = 1024;
+	record->seq = malloc(seqCap);
+	record->length = 0;
+	if (reader->line[0] == '>') {
+		int nameLength = strcspn(reader->line + 1, " \t\r\n");
+		record->name = strndup(reader->line + 1, nameLength);
+		n = getline(&reader->line, &reader->lineCap, reader->fp);
+	}
+	else {
+		record->name = strdup(reader->fileName);
+		n = strlen(reader->line);
+	}
+	if (!record->seq || !record->name) {
+		fprintf(stderr, "Unable to allocate a record of %s\n", reader->fileName);
+		exit(1);
+	}
+	reader->pending = 0;
+	while (n > 0) {
+		if (reader->line[0] == '>') {
+			reader->pending = 1;
+			break;
+		}
+		for (ssize_t c = 0; c < n; c++) {
+			char base = reader->line[c];
+			if (base == '\n' || base == '\r' || base == ' ' || base == '\t')
+				continue;
+			if (record->length + 1 >= seqCap) {
+				seqCap *= 2;
+				record->seq = realloc(record->seq, seqCap);
+				if (!record->seq) {
+					fprintf(stderr, "Unable to allocate %s of %s\n", record->name, reader->fileName);
+					exit(1);
+				}
+			}
+			record->seq[record->length++] = base;
+		}
+		n = getline(&reader->line, &reader->lineCap, reader->fp);
+	}
+	record->seq[record->length] = '\0';
+	return 1;
+}
+
+void runReader(FastaReader* queries, FastaReader* subjects, Queue* jobs, int numWorkers) {
+	long int number = 0;
+	for (;;) {
+		Job* job = malloc(sizeof(Job));
+		if (!job) {
+			fprintf(stderr, "Unable to allocate pair %ld\n", number);
+			exit(1);
+		}
+		if (!readRecord(queries, &job->query)) {
+			free(job);
+			break;
+		}
+		if (!readRecord(subjects, &job->subject)) {
+			fprintf(stderr, "%s has more records than %s, the rest are skipped\n", queries->fileName, subjects->fileName);
+			free(job->query.name);
+			free(job->query.seq);
+			free(job);
+			break;
+		}
+		job->number = number++;
+		job->cigar = NULL;
+		queuePush(jobs, job);
+	}
+	//one end marker per worker
+	for (int w = 0; w < numWorkers; w++)
+		queuePush(jobs, NULL);
+	fclose(queries->fp);
+	fclose(subjects->fp);
+	free(queries->line);
+	free(subjects->line);
+}
+
+void runWorker(Queue* jobs, Queue* results) {
+	//matrices are kept between pairs and only grow
+	char* tbBuffer = NULL;
+	long tbCapacity = 0;
+	int* rowBuffer = NULL;
+	int rowCapacity = 0;
+	Job* job;
+	while ((job = queuePop(jobs)) != NULL) {
+		alignPair(job, &tbBuffer, &tbCapacity, &rowBuffer, &rowCapacity);
+		queuePush(results, job);
+	}
+	queuePush(results, NULL);
+	free(tbBuffer);
+	free(rowBuffer);
+}
+
+void runWriter(Queue* results, int numWorkers, long int* numPairs, long int* numCells) {
+	int finished = 0;
+	while (finished < numWorkers) {
+		Job* job = queuePop(results);
+		if (job == NULL) {
+			finished++;
+			continue;
+		}
+		if (outputFormat == JSON)
+			writeJson(job);
+		else
+			writePaf(job);
+		(*numPairs)++;
+		*numCells += (long int)job->query.length * job->subject.length;
+		freeJob(job);
+	}
+}
+
+//Single threaded fill of one pair, row by row with two score rows and a byte per
+//traceback cell. Ties and end cells are chosen like Align_Omp. The fill is kept
+//here because each worker aligns a whole pair alone with the scores given at run
+//time, which neither PairKernel.h (scores fixed at compile time) nor the Align_Omp
+//kernels (one matrix filled by a thread team) are built for. Align_Test checks it
+//against the shared reference.
+void alignPair(Job* job, char** tbBuffer, long* tbCapacity, int** rowBuffer, int* rowCapacity) {
+	char* query = job->query.seq;
+	char* subject = job->subject.seq;
+	int rows = job->query.length + 1;
+	int cols = job->subject.length + 1;
+	int flags = modeFlags[mode];
+	int local = mode == LOCAL;
+	long cells = (long)rows * cols;
+	if (cells > *tbCapacity) {
+		free(*tbBuffer);
+		*tbBuffer = malloc(cells);
+		*tbCapacity = *tbBuffer ? cells : 0;
+	}
+	//two score rows and the last column
+	if (2 * cols + rows > *rowCapacity) {
+		free(*rowBuffer);
+		*rowBuffer = malloc((2 * cols + rows) * sizeof(int));
+		*rowCapacity = *rowBuffer ? 2 * cols + rows : 0;
+	}
+	if (!*tbBuffer || !*rowBuffer) {
+		fprintf(stderr, "Unable to allocate matrices for %s against %s\n", job->query.name, job->subject.name);
+		exit(1);
+	}
+	char* tbMatrix = *tbBuffer;
+	int* prevRow = *rowBuffer;
+	int* currRow = prevRow + cols;
+	int* lastColumn = currRow + cols;
+
+	tbMatrix[0] = NONE;
+	prevRow[0] = 0;
+	lastColumn[0] = 0;
+	for (int j = 1; j < cols; j++) {
+		prevRow[j] = (flags & FREE_SUBJECT_START) ? 0 : j * gapScore;
+		tbMatrix[j] = (flags & FREE_SUBJECT_START) ? NONE : LEFT;
+	}
+	if (cols > 1)
+		lastColumn[0] = prevRow[cols - 1];
+	int bestScore = 0;
+	long bestPos = 0;
+	for (int i = 1; i < rows; i++) {
+		long rowIndex = (long)cols * i;
+		currRow[0] = (flags & FREE_QUERY_START) ? 0 : i * gapScore;
+		tbMatrix[rowIndex] = (flags & FREE_QUERY_START) ? NONE : UP;
+		char q = query[i-1];
+		for (int j = 1; j < cols; j++) {
+			int max = prevRow[j-1] + (q == subject[j-1] ? matchScore : mismatchScore);
+			int pred = DIAG;
+			if (currRow[j-1] + gapScore > max) {
+				max = currRow[j-1] + gapScore;
+				pred = LEFT;
+			}
+			if (prevRow[j] + gapScore > max) {
+				max = prevRow[j] + gapScore;
+				pred = UP;
+			}
+			if (local && max <= 0) {
+				max = 0;
+				pred = NONE;
+			}
+			currRow[j] = max;
+			tbMatrix[rowIndex + j] = pred;
+			if (local && max > bestScore) {
+				bestScore = max;
+				bestPos = rowIndex + j;
+			}
+		}
+		lastColumn[i] = currRow[cols - 1];
+		int* temp = prevRow;
+		prevRow = currRow;
+		currRow = temp;
+	}
+	if (!local) {
+		//bottom right corner unless the mode lets trailing gaps go unpenalized
+		bestPos = cells - 1;
+		bestScore = lastColumn[rows - 1];
+		if (flags & FREE_QUERY_END) {
+			for (int i = 1; i < rows; i++) {
+				if (lastColumn[i] > bestScore) {
+					bestScore = lastColumn[i];
+					bestPos = (long)cols * i + cols - 1;
+				}
+			}
+		}
+		if (flags & FREE_SUBJECT_END) {
+			for (int j = 1; j < cols; j++) {
+				if (prevRow[j] > bestScore) {
+					bestScore = prevRow[j];
+					bestPos = (long)cols * (rows - 1) + j;
+				}
+			}
+		}
+	}
+
+	//the CIGAR is written from the back so it comes out in reading order
+	int cigarStart = 2 * (rows + cols);
+	char* cigarBuffer = malloc(cigarStart + 1);
+	if (!cigarBuffer) {
+		fprintf(stderr, "Unable to allocate the CIGAR of %s against %s\n", job->query.name, job->subject.name);
+		exit(1);
+	}
+	cigarBuffer[cigarStart] = '\0';
+	char runOp = 0;
+	int runLength = 0;
+	job->length = 0;
+	job->matches = 0;
+	job->editDistance = 0;
+	long currPos = bestPos;
+	while (tbMatrix[currPos] != NONE) {
+		int i = currPos / cols;
+		int j = currPos % cols;
+		char op;
+		if (tbMatrix[currPos] == DIAG) {
+			op = 'M';
+			if (query[i-1] == subject[j-1])
+				job->matches++;
+			else
+				job->editDistance++;
+			currPos -= cols + 1;
+		}
+		else if (tbMatrix[currPos] == UP) {
+			op = 'I';
+			job->editDistance++;
+			currPos -= cols;
+		}
+		else {
+			op = 'D';
+			job->editDistance++;
+			currPos -= 1;
+		}
+		if (op != runOp) {
+			cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+			runOp = op;
+			runLength = 0;
+		}
+		runLength++;
+		job->length++;
+	}
+	cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+	job->score = bestScore;
+	job->queryStart = currPos / cols;
+	job->subjectStart = currPos % cols;
+	job->queryEnd = bestPos / cols;
+	job->subjectEnd = bestPos % cols;
+	job->cigar = strdup(cigarBuffer + cigarStart);
+	free(cigarBuffer);
+	if (!job->cigar) {
+		fprintf(stderr, "Unable to allocate the CIGAR of %s against %s\n", job->query.name, job->subject.name);
+		exit(1);
+	}
+}
+
+int prependCigarOp(char* cigar, int start, char op, int length) {
+	if (length == 0)
+		return start;
+	cigar[--start] = op;
+	do {
+		cigar[--start] = '0' + length % 10;
+		length /= 10;
+	} while (length > 0);
+	return start;
+}
+
+void writePaf(Job* job) {
+	if (job->length == 0)
+		return;
+	printf("%s\t%d\t%d\t%d\t+\t%s\t%d\t%d\t%d\t%d\t%d\t255\tAS:i:%ld\tNM:i:%d\tcg:Z:%s\n",
+		job->query.name, job->query.length, job->queryStart, job->queryEnd,
+		job->subject.name, job->subject.length, job->subjectStart, job->subjectEnd,
+		job->matches, job->length, job->score, job->editDistance, job->cigar);
+}
+
+void writeJson(Job* job) {
+	printf("{\"pair\":%ld,\"query\":\"%s\",\"subject\":\"%s\",\"mode\":\"%s\",\"score\":%ld,"
+		"\"query_start\":%d,\"query_end\":%d,\"subject_start\":%d,\"subject_end\":%d,"
+		"\"length\":%d,\"matches\":%d,\"edit_distance\":%d,\"cigar\":\"%s\"}\n",
+		job->number, job->query.name, job->subject.name, modeNames[mode], job->score,
+		job->queryStart, job->queryEnd, job->subjectStart, job->subjectEnd,
+		job->length, job->matches, job->editDistance, job->cigar);
+}
+
+void freeJob(Job* job) {
+	free(job->query.name);
+	free(job->query.seq);
+	free(job->subject.name);
+	free(job->subject.seq);
+	free(job->cigar);
+	free(job);
+}
+
+char* baseName(char* path) {
+	char* slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
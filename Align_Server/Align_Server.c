@@ -0,0 +1,773 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <omp.h>
+
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//Define alignment modes
+#define GLOBAL 0
+#define LOCAL 1
+#define SEMIGLOBAL 2
+#define OVERLAP 3
+#define GLOCAL 4
+//Define free end gap flags, rows of the matrix are the query and columns the subject
+#define FREE_QUERY_START 1
+#define FREE_QUERY_END 2
+#define FREE_SUBJECT_START 4
+#define FREE_SUBJECT_END 8
+//Frame magics, "ALNQ" and "ALNR" in memory order
+#define REQUEST_MAGIC 0x514e4c41
+#define RESPONSE_MAGIC 0x524e4c41
+//Response status
+#define STATUS_OK 0
+#define STATUS_BAD_MODE 1
+#define STATUS_TOO_LARGE 2
+#define STATUS_NO_MEMORY 3
+//Largest traceback matrix a request may ask for, in cells
+#define MAX_CELLS (1L << 28)
+//Largest pair of sequences a request may carry, and the most bytes buffered per
+//connection in each direction. A client over the output limit is not read until
+//it takes its responses.
+#define MAX_SEQUENCES (1L << 24)
+#define MAX_INPUT (2 * MAX_SEQUENCES)
+#define MAX_OUTPUT (1L << 26)
+#define MAX_CLIENTS 256
+#define DEFAULT_BATCH 64
+
+//Both frames are sent in host byte order, the socket never leaves the machine
+typedef struct {
+	uint32_t magic;
+	uint32_t id;   //echoed back so clients can pipeline requests
+	uint8_t mode;
+	int8_t matchScore, mismatchScore, gapScore;
+	uint32_t queryLength, subjectLength;   //the two sequences follow the header
+} RequestHeader;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t id;
+	int32_t status;
+	int32_t score;
+	int32_t queryStart, queryEnd, subjectStart, subjectEnd;   //0 based, half open
+	int32_t length, matches, editDistance;
+	uint32_t cigarLength;   //the CIGAR follows the header, without a terminator
+} ResponseHeader;
+
+//Bytes waiting on one connection in each direction
+typedef struct {
+	int fd;
+	char* in;
+	long inLength, inCapacity;
+	char* out;
+	long outLength, outCapacity;
+} Client;
+
+//One request of a batch, the sequences point into the client's input buffer. The
+//CIGAR buffer belongs to the batch slot and is kept for the next request in it.
+typedef struct {
+	int client;
+	RequestHeader header;
+	char* query, * subject;
+	ResponseHeader response;
+	char* cigar;
+	char* cigarBuffer;
+	long cigarCapacity;
+} Job;
+
+//Matrices a thread keeps between batches, only grown, never shrunk
+typedef struct {
+	char* tbMatrix;
+	long tbCapacity;
+	int* rows;
+	long rowCapacity;
+} Arena;
+
+int runServer(char* path, int numThreads, int batchSize, int batchWait);
+int runClient(char* path, char* queryFile, char* subjectFile, int mode, int repeats);
+int acceptClient(int listenFd);
+void closeClient(int c);
+int readClient(int c);
+int flushClient(int c);
+int pollClients(int listenFd, int timeout);
+int parseJobs(int c, int batchSize);
+void alignPair(Job* job, Arena* arena);
+void appendResponse(Job* job);
+int queueResponse(int c, ResponseHeader* response, char* cigar);
+void compactInput(int c);
+int reserve(char** buffer, long* capacity, long needed);
+int prependCigarOp(char* cigar, int start, char op, int length);
+int writeAll(int fd, void* data, long length);
+int readAll(int fd, void* data, long length);
+char* readSequence(char* path, int* length);
+int parseMode(char* name);
+void stopServer(int signal);
+
+//Default scores, a request carries its own
+int matchScore = 2;
+int mismatchScore = -2;
+int gapScore = -5;
+
+const char* modeNames[] = {"global", "local", "semiglobal", "overlap", "glocal"};
+//Free end gaps of each mode, same meaning as in Align_Omp
+const int modeFlags[] = {
+	0,
+	FREE_QUERY_START | FREE_SUBJECT_START,
+	FREE_QUERY_START | FREE_QUERY_END | FREE_SUBJECT_START | FREE_SUBJECT_END,
+	FREE_QUERY_START | FREE_SUBJECT_END,
+	FREE_SUBJECT_START | FREE_SUBJECT_END
+};
+
+Client clients[MAX_CLIENTS];
+long parsedLength[MAX_CLIENTS];
+//body bytes of a rejected request still to be dropped from each connection
+long skipLength[MAX_CLIENTS];
+int numClients = 0;
+Job* batch;
+int batchCount = 0;
+Arena* arenas;
+volatile sig_atomic_t stopping = 0;
+long numRequests = 0;
+long numBatches = 0;
+long numCells = 0;
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		printf("Please enter in this format: Align_Server <socket_path> <num_threads> [-b batch_size] [-w batch_wait_us]\n");
+		printf("\tor as a client: Align_Server -c <socket_path> <query_file> <subject_file> <global|local|semiglobal|overlap|glocal> [-s match mismatch gap] [-n repeats]\n");
+		return 1;
+	}
+	if (strcmp(argv[1], "-c") == 0) {
+		if (argc < 6) {
+			printf("A client needs a socket, a query, a subject and a mode\n");
+			return 1;
+		}
+		int mode = parseMode(argv[5]);
+		if (mode < 0) {
+			printf("Unknown alignment mode: %s\n", argv[5]);
+			return 1;
+		}
+		int repeats = 1;
+		for (int a = 6; a < argc; a++) {
+			if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+				matchScore = atoi(argv[++a]);
+				mismatchScore = atoi(argv[++a]);
+				gapScore = atoi(argv[++a]);
+			}
+			else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+				repeats = atoi(argv[++a]);
+			}
+			else {
+				printf("Unknown option: %s\n", argv[a]);
+				return 1;
+			}
+		}
+		//the scores travel as single bytes in the request header
+		if (matchScore < INT8_MIN || matchScore > INT8_MAX || mismatchScore < INT8_MIN || mismatchScore > INT8_MAX
+			|| gapScore < INT8_MIN || gapScore > INT8_MAX) {
+			printf("Scores must be between %d and %d\n", INT8_MIN, INT8_MAX);
+			return 1;
+		}
+		return runClient(argv[2], argv[3], argv[4], mode, repeats < 1 ? 1 : repeats);
+	}
+
+	int numThreads = atoi(argv[2]);
+	int batchSize = DEFAULT_BATCH;
+	int batchWait = 0;
+	for (int a = 3; a < argc; a++) {
+		if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			batchSize = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc) {
+			batchWait = atoi(argv[++a]);
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	if (numThreads < 1)
+		numThreads = 1;
+	if (batchSize < 1)
+		batchSize = 1;
+	return runServer(argv[1], numThreads, batchSize, batchWait);
+}
+
+int parseMode(char* name) {
+	for (int m = GLOBAL; m <= GLOCAL; m++) {
+		if (strcmp(name, modeNames[m]) == 0)
+			return m;
+	}
+	return -1;
+}
+
+//The poll loop. Every readable connection is drained into the batch, the batch is
+//aligned by the whole team at once and the responses are queued on their clients.
+int runServer(char* path, int numThreads, int batchSize, int batchWait) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		printf("Socket path too long: %s\n", path);
+		return 1;
+	}
+	int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0) {
+		printf("Unable to create a socket: %s\n", strerror(errno));
+		return 1;
+	}
+	strcpy(address.sun_path, path);
+	unlink(path);
+	if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 64) != 0) {
+		printf("Unable to listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+
+	batch = calloc(batchSize, sizeof(Job));
+	arenas = calloc(numThreads, sizeof(Arena));
+	if (!batch || !arenas) {
+		printf("Unable to allocate a batch of %d requests for %d threads\n", batchSize, numThreads);
+		close(listenFd);
+		unlink(path);
+		return 1;
+	}
+	double busyTime = 0;
+	double initialTime = omp_get_wtime();
+
+	printf("======================================\n");
+	printf("Listening on %s with %d threads, batches of up to %d requests\n", path, numThreads, batchSize);
+	fflush(stdout);
+
+	while (!stopping) {
+		if (!pollClients(listenFd, -1))
+			continue;
+		//give a partial batch a short while to fill up before aligning it
+		if (batchWait > 0)
+			pollClients(listenFd, batchWait);
+
+		//requests are only parsed here, no buffer moves until the batch is answered
+		while (1) {
+			for (int c = 0; c < numClients && batchCount < batchSize; c++)
+				parseJobs(c, batchSize);
+			if (batchCount == 0)
+				break;
+			double batchTime = omp_get_wtime();
+			long batchCells = 0;
+			//threads stay alive between parallel regions, so a batch costs no team startup
+			#pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1) reduction(+:batchCells) \
+			default(none) shared(batch, batchCount, arenas)
+			for (int k = 0; k < batchCount; k++) {
+				alignPair(&batch[k], &arenas[omp_get_thread_num()]);
+				batchCells += (long)batch[k].header.queryLength * batch[k].header.subjectLength;
+			}
+			for (int k = 0; k < batchCount; k++)
+				appendResponse(&batch[k]);
+			for (int c = 0; c < numClients; c++) {
+				compactInput(c);
+				flushClient(c);
+			}
+			busyTime += omp_get_wtime() - batchTime;
+			numRequests += batchCount;
+			numCells += batchCells;
+			numBatches++;
+			batchCount = 0;
+		}
+	}
+
+	close(listenFd);
+	unlink(path);
+	double timeElapsed = omp_get_wtime() - initialTime;
+	printf("\n======================================\n");
+	printf("SERVER STOPPED\n");
+	printf("1) REQUESTS SERVED: %ld in %ld batches\n", numRequests, numBatches);
+	printf("2) CELLS COMPUTED: %ld\n", numCells);
+	printf("3) TIME ELAPSED: %fs (%fs aligning)\n", timeElapsed, busyTime);
+	printf("4) GCUPS WHILE ALIGNING: %f\n", busyTime > 0 ? numCells / busyTime / 1e9 : 0.0);
+	printf("======================================\n");
+	return 0;
+}
+
+//Waits up to timeout microseconds (forever if negative), then accepts, reads and
+//writes whatever is ready. Returns the number of descriptors that were ready.
+int pollClients(int listenFd, int timeout) {
+	struct pollfd fds[MAX_CLIENTS + 1];
+	fds[0].fd = listenFd;
+	fds[0].events = POLLIN;
+	for (int c = 0; c < numClients; c++) {
+		fds[c+1].fd = clients[c].fd;
+		//a full input buffer is only read again once the batch loop consumed it
+		fds[c+1].events = (clients[c].inLength < MAX_INPUT ? POLLIN : 0) | (clients[c].outLength ? POLLOUT : 0);
+	}
+	struct timespec wait = {timeout / 1000000, timeout % 1000000 * 1000};
+	int ready = ppoll(fds, numClients + 1, timeout < 0 ? NULL : &wait, NULL);
+	if (ready <= 0)
+		return 0;
+	if (fds[0].revents & POLLIN)
+		acceptClient(listenFd);
+	//walk backwards so closing a client does not skip the one moved into its place
+	for (int c = numClients - 1; c >= 0; c--) {
+		short events = fds[c+1].revents;
+		if ((events & POLLOUT) && !flushClient(c)) {
+			closeClient(c);
+			continue;
+		}
+		if ((events & (POLLIN | POLLHUP | POLLERR)) && !readClient(c))
+			closeClient(c);
+	}
+	return ready;
+}
+
+void stopServer(int signal) {
+	(void)signal;
+	stopping = 1;
+}
+
+int acceptClient(int listenFd) {
+	int fd = accept(listenFd, NULL, NULL);
+	if (fd < 0)
+		return 0;
+	if (numClients == MAX_CLIENTS) {
+		close(fd);
+		return 0;
+	}
+	Client* client = &clients[numClients++];
+	memset(client, 0, sizeof(Client));
+	client->fd = fd;
+	parsedLength[numClients - 1] = 0;
+	skipLength[numClients - 1] = 0;
+	return 1;
+}
+
+void closeClient(int c) {
+	close(clients[c].fd);
+	free(clients[c].in);
+	free(clients[c].out);
+	clients[c] = clients[--numClients];
+	parsedLength[c] = parsedLength[numClients];
+	skipLength[c] = skipLength[numClients];
+}
+
+//Reads whatever is waiting without blocking, up to MAX_INPUT buffered bytes. Returns
+//0 once the client is gone.
+int readClient(int c) {
+	Client* client = &clients[c];
+	while (client->inLength < MAX_INPUT) {
+		if (!reserve(&client->in, &client->inCapacity, client->inLength + 65536))
+			return 0;
+		long room = (client->inCapacity < MAX_INPUT ? client->inCapacity : MAX_INPUT) - client->inLength;
+		long n = recv(client->fd, client->in + client->inLength, room, MSG_DONTWAIT);
+		if (n > 0) {
+			client->inLength += n;
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 1;
+		if (n < 0 && errno == EINTR)
+			continue;
+		return 0;
+	}
+	return 1;
+}
+
+//Writes as much of the pending output as the socket takes
+int flushClient(int c) {
+	Client* client = &clients[c];
+	long sent = 0;
+	while (sent < client->outLength) {
+		long n = send(client->fd, client->out + sent, client->outLength - sent, MSG_DONTWAIT);
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 0;
+		sent += n;
+	}
+	memmove(client->out, client->out + sent, client->outLength - sent);
+	client->outLength -= sent;
+	return 1;
+}
+
+//Moves the complete requests of a client into the batch, parsedLength marks how far
+//the input was consumed so compactInput can drop it once the batch is answered.
+//Requests over the size limits are answered from their header and their body is
+//dropped as it arrives, without ever being buffered whole.
+int parseJobs(int c, int batchSize) {
+	Client* client = &clients[c];
+	long offset = parsedLength[c];
+	long skip = skipLength[c] < client->inLength - offset ? skipLength[c] : client->inLength - offset;
+	offset += skip;
+	skipLength[c] -= skip;
+	while (skipLength[c] == 0 && batchCount < batchSize && client->outLength < MAX_OUTPUT
+		&& client->inLength - offset >= (long)sizeof(RequestHeader)) {
+		RequestHeader header;
+		memcpy(&header, client->in + offset, sizeof(header));
+		long bodyLength = (long)header.queryLength + header.subjectLength;
+		if (header.magic != REQUEST_MAGIC) {
+			//a stream we cannot frame, drop it and hang up once the batch is answered
+			client->inLength = offset;
+			shutdown(client->fd, SHUT_RD);
+			break;
+		}
+		if (bodyLength > MAX_SEQUENCES || ((long)header.queryLength + 1) * ((long)header.subjectLength + 1) > MAX_CELLS) {
+			ResponseHeader response;
+			memset(&response, 0, sizeof(response));
+			response.magic = RESPONSE_MAGIC;
+			response.id = header.id;
+			response.status = STATUS_TOO_LARGE;
+			if (!queueResponse(c, &response, NULL))
+				shutdown(client->fd, SHUT_RDWR);
+			offset += sizeof(header);
+			skip = bodyLength < client->inLength - offset ? bodyLength : client->inLength - offset;
+			offset += skip;
+			skipLength[c] = bodyLength - skip;
+			continue;
+		}
+		long frameLength = sizeof(header) + bodyLength;
+		if (client->inLength - offset < frameLength)
+			break;
+		Job* job = &batch[batchCount++];
+		job->client = c;
+		job->header = header;
+		job->query = client->in + offset + sizeof(header);
+		job->subject = job->query + header.queryLength;
+		offset += frameLength;
+	}
+	parsedLength[c] = offset;
+	return 1;
+}
+
+void compactInput(int c) {
+	Client* client = &clients[c];
+	memmove(client->in, client->in + parsedLength[c], client->inLength - parsedLength[c]);
+	client->inLength -= parsedLength[c];
+	parsedLength[c] = 0;
+}
+
+//Grows buffer to at least needed bytes, returns 0 and leaves it as it was if the
+//memory is not there
+int reserve(char** buffer, long* capacity, long needed) {
+	if (needed <= *capacity)
+		return 1;
+	long size = *capacity ? *capacity : 4096;
+	while (size < needed)
+		size *= 2;
+	char* grown = realloc(*buffer, size);
+	if (!grown)
+		return 0;
+	*buffer = grown;
+	*capacity = size;
+	return 1;
+}
+
+void appendResponse(Job* job) {
+	//a client whose response cannot be queued is hung up on at the next poll
+	if (!queueResponse(job->client, &job->response, job->cigar))
+		shutdown(clients[job->client].fd, SHUT_RDWR);
+}
+
+int queueResponse(int c, ResponseHeader* response, char* cigar) {
+	Client* client = &clients[c];
+	long length = sizeof(ResponseHeader) + response->cigarLength;
+	if (!reserve(&client->out, &client->outCapacity, client->outLength + length))
+		return 0;
+	memcpy(client->out + client->outLength, response, sizeof(ResponseHeader));
+	if (response->cigarLength)
+		memcpy(client->out + client->outLength + sizeof(ResponseHeader), cigar, response->cigarLength);
+	client->outLength += length;
+	return 1;
+}
+
+//Single threaded fill of one pair, row by row with two score rows and a byte per
+//traceback cell, the same recurrence, ties and end cells as Align_Pipeline. All
+//buffers come from the thread's arena so a warm server does no allocation.
+//The fill is kept here rather than shared: every request brings its own scores and
+//mode and one pair runs on one thread, while PairKernel.h fixes the scores at
+//compile time and the Align_Omp kernels fill a whole matrix with a thread team.
+//Align_Test checks the server against the same reference as those programs.
+void alignPair(Job* job, Arena* arena) {
+	RequestHeader* h = &job->header;
+	ResponseHeader* r = &job->response;
+	memset(r, 0, sizeof(ResponseHeader));
+	r->magic = RESPONSE_MAGIC;
+	r->id = h->id;
+	job->cigar = NULL;
+	long rows = (long)h->queryLength + 1;
+	long cols = (long)h->subjectLength + 1;
+	long cells = rows * cols;
+	if (h->mode > GLOCAL) {
+		r->status = STATUS_BAD_MODE;
+		return;
+	}
+	if (cells > MAX_CELLS) {
+		r->status = STATUS_TOO_LARGE;
+		return;
+	}
+	char* query = job->query;
+	char* subject = job->subject;
+	int match = h->matchScore, mismatch = h->mismatchScore, gap = h->gapScore;
+	int flags = modeFlags[h->mode];
+	int local = h->mode == LOCAL;
+	if (!reserve(&arena->tbMatrix, &arena->tbCapacity, cells)
+		|| !reserve((char**)&arena->rows, &arena->rowCapacity, (2 * cols + rows) * sizeof(int))
+		|| !reserve(&job->cigarBuffer, &job->cigarCapacity, 2 * (rows + cols) + 1)) {
+		r->status = STATUS_NO_MEMORY;
+		return;
+	}
+	char* tbMatrix = arena->tbMatrix;
+	int* prevRow = arena->rows;
+	int* currRow = prevRow + cols;
+	int* lastColumn = currRow + cols;
+
+	tbMatrix[0] = NONE;
+	prevRow[0] = 0;
+	lastColumn[0] = 0;
+	for (int j = 1; j < cols; j++) {
+		prevRow[j] = (flags & FREE_SUBJECT_START) ? 0 : j * gap;
+		tbMatrix[j] = (flags & FREE_SUBJECT_START) ? NONE : LEFT;
+	}
+	if (cols > 1)
+		lastColumn[0] = prevRow[cols - 1];
+	int bestScore = 0;
+	long bestPos = 0;
+	for (int i = 1; i < rows; i++) {
+		long rowIndex = cols * i;
+		currRow[0] = (flags & FREE_QUERY_START) ? 0 : i * gap;
+		tbMatrix[rowIndex] = (flags & FREE_QUERY_START) ? NONE : UP;
+		char q = query[i-1];
+		for (int j = 1; j < cols; j++) {
+			int max = prevRow[j-1] + (q == subject[j-1] ? match : mismatch);
+			int pred = DIAG;
+			if (currRow[j-1] + gap > max) {
+				max = currRow[j-1] + gap;
+				pred = LEFT;
+			}
+			if (prevRow[j] + gap > max) {
+				max = prevRow[j] + gap;
+				pred = UP;
+			}
+			if (local && max <= 0) {
+				max = 0;
+				pred = NONE;
+			}
+			currRow[j] = max;
+			tbMatrix[rowIndex + j] = pred;
+			if (local && max > bestScore) {
+				bestScore = max;
+				bestPos = rowIndex + j;
+			}
+		}
+		lastColumn[i] = currRow[cols - 1];
+		int* temp = prevRow;
+		prevRow = currRow;
+		currRow = temp;
+	}
+	if (!local) {
+		//bottom right corner unless the mode lets trailing gaps go unpenalized
+		bestPos = cells - 1;
+		bestScore = lastColumn[rows - 1];
+		if (flags & FREE_QUERY_END) {
+			for (int i = 1; i < rows; i++) {
+				if (lastColumn[i] > bestScore) {
+					bestScore = lastColumn[i];
+					bestPos = cols * i + cols - 1;
+				}
+			}
+		}
+		if (flags & FREE_SUBJECT_END) {
+			for (int j = 1; j < cols; j++) {
+				if (prevRow[j] > bestScore) {
+					bestScore = prevRow[j];
+					bestPos = cols * (rows - 1) + j;
+				}
+			}
+		}
+	}
+
+	//the CIGAR is written from the back so it comes out in reading order
+	char* cigarBuffer = job->cigarBuffer;
+	int cigarEnd = 2 * (rows + cols);
+	int cigarStart = cigarEnd;
+	char runOp = 0;
+	int runLength = 0;
+	long currPos = bestPos;
+	while (tbMatrix[currPos] != NONE) {
+		int i = currPos / cols;
+		int j = currPos % cols;
+		char op;
+		if (tbMatrix[currPos] == DIAG) {
+			op = 'M';
+			if (query[i-1] == subject[j-1])
+				r->matches++;
+			else
+				r->editDistance++;
+			currPos -= cols + 1;
+		}
+		else if (tbMatrix[currPos] == UP) {
+			op = 'I';
+			r->editDistance++;
+			currPos -= cols;
+		}
+		else {
+			op = 'D';
+			r->editDistance++;
+			currPos -= 1;
+		}
+		if (op != runOp) {
+			cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+			runOp = op;
+			runLength = 0;
+		}
+		runLength++;
+		r->length++;
+	}
+	cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+	r->status = STATUS_OK;
+	r->score = bestScore;
+	r->queryStart = currPos / cols;
+	r->subjectStart = currPos % cols;
+	r->queryEnd = bestPos / cols;
+	r->subjectEnd = bestPos % cols;
+	r->cigarLength = cigarEnd - cigarStart;
+	job->cigar = cigarBuffer + cigarStart;
+}
+
+int prependCigarOp(char* cigar, int start, char op, int length) {
+	if (length == 0)
+		return start;
+	cigar[--start] = op;
+	do {
+		cigar[--start] = '0' + length % 10;
+		length /= 10;
+	} while (length > 0);
+	return start;
+}
+
+//Client side, sends the same pair repeats times back to back and reports the
+//result and the mean round trip of a request
+int runClient(char* path, char* queryFile, char* subjectFile, int mode, int repeats) {
+	int queryLength, subjectLength;
+	char* query = readSequence(queryFile, &queryLength);
+	char* subject = readSequence(subjectFile, &subjectLength);
+	if (!query || !subject) {
+		printf("Unable to read %s or %s\n", queryFile, subjectFile);
+		return 1;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		printf("Unable to connect to %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	RequestHeader header = {REQUEST_MAGIC, 0, mode, matchScore, mismatchScore, gapScore, queryLength, subjectLength};
+	ResponseHeader response;
+	char* cigar = NULL;
+	double initialTime = omp_get_wtime();
+	for (int k = 0; k < repeats; k++) {
+		header.id = k;
+		if (!writeAll(fd, &header, sizeof(header)) || !writeAll(fd, query, queryLength) || !writeAll(fd, subject, subjectLength)
+			|| !readAll(fd, &response, sizeof(response))) {
+			printf("Connection to %s lost\n", path);
+			return 1;
+		}
+		free(cigar);
+		cigar = malloc(response.cigarLength + 1);
+		if (!cigar) {
+			printf("Unable to allocate a CIGAR of %u characters\n", response.cigarLength);
+			return 1;
+		}
+		if (!readAll(fd, cigar, response.cigarLength)) {
+			printf("Connection to %s lost\n", path);
+			return 1;
+		}
+		cigar[response.cigarLength] = '\0';
+	}
+	double timeElapsed = omp_get_wtime() - initialTime;
+	close(fd);
+
+	if (response.status != STATUS_OK) {
+		const char* reasons[] = {"", "unknown mode", "pair too large", "out of memory"};
+		printf("Request rejected: %s\n", reasons[response.status < 4 ? response.status : 0]);
+		return 1;
+	}
+	printf("\n======================================\n");
+	printf("%s ALIGNMENT FROM %s\n", modeNames[mode], path);
+	printf("1) FINAL SCORE: %d\n", response.score);
+	printf("2) QUERY START: %d QUERY END: %d\n", response.queryStart, response.queryEnd);
+	printf("3) SUBJECT START: %d SUBJECT END: %d\n", response.subjectStart, response.subjectEnd);
+	printf("4) LENGTH: %d MATCHES: %d EDIT DISTANCE: %d\n", response.length, response.matches, response.editDistance);
+	printf("5) CIGAR: %s\n", cigar);
+	printf("6) REQUESTS: %d, MEAN ROUND TRIP: %fms\n", repeats, timeElapsed / repeats * 1e3);
+	printf("======================================\n");
+	free(cigar);
+	return 0;
+}
+
+int writeAll(int fd, void* data, long length) {
+	char* p = data;
+	while (length > 0) {
+		long n = write(fd, p, length);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 0;
+		p += n;
+		length -= n;
+	}
+	return 1;
+}
+
+int readAll(int fd, void* data, long length) {
+	char* p = data;
+	while (length > 0) {
+		long n = read(fd, p, length);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 0;
+		p += n;
+		length -= n;
+	}
+	return 1;
+}
+
+//Reads a sequence file like the other programs, one line of bases
+char* readSequence(char* path, int* length) {
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	rewind(fp);
+	char* seq = malloc(size + 1);
+	if (!seq) {
+		fclose(fp);
+		return NULL;
+	}
+	long n = fread(seq, 1, size, fp);
+	fclose(fp);
+	while (n > 0 && (seq[n-1] == '\n' || seq[n-1] == '\r'))
+		n--;
+	seq[n] = '\0';
+	*length = n;
+	return seq;
+}
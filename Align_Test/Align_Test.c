@@ -0,0 +1,703 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <omp.h>
+
+//Scores of the engines under test, global runs use the first set and every other
+//mode the second
+#define NW_MATCH 4
+#define NW_MISMATCH -1
+#define NW_GAP -5
+#define SW_MATCH 2
+#define SW_MISMATCH -2
+#define SW_GAP -5
+//X-drop threshold, low enough that a mismatch next to the seed empties the
+//anti-diagonal after it
+#define XDROP_LIMIT 5
+//Define alignment modes, the order of Align_Omp
+#define GLOBAL 0
+#define LOCAL 1
+#define SEMIGLOBAL 2
+#define OVERLAP 3
+#define GLOCAL 4
+#define XDROP 5
+#define NUM_MODES 6
+//Define which ends of the sequences a mode leaves unaligned at no cost
+#define FREE_QUERY_START 1
+#define FREE_QUERY_END 2
+#define FREE_SUBJECT_START 4
+#define FREE_SUBJECT_END 8
+#define FREE_ALL 15
+//Define how an engine prints its alignment
+#define BLOCK_OUTPUT 0  //FINAL SCORE and ALIGNMENT STRING block
+#define PAF_OUTPUT 1    //PAF record with the score and CIGAR tags
+#define REPLY_OUTPUT 2  //client of the server the test starts, score and CIGAR lines
+#define HITS_OUTPUT 3   //best hit of a database search
+//Define pair kinds, each aims at a different weak spot
+#define RANDOM 0        //unrelated sequences of different lengths
+#define MUTATED 1       //subject is the query with substitutions and indels
+#define HOMOPOLYMER 2   //long runs of two bases, many equal scoring paths
+#define CONTAINED 3     //query is a piece of a much longer subject
+#define IDENTICAL 4
+#define SINGLE 5        //one base against a sequence
+#define DISJOINT 6      //no base in common, local score is 0
+#define SEED_MISMATCH 7 //mutated copy starting with a mismatch, X-drop has to step over it
+#define NUM_KINDS 8
+//Long pairs run first, their scores leave the 16 bit range at the global scores
+#define LONG_IDENTICAL 8
+#define LONG_DISJOINT 9 //two homopolymers with no base in common
+#define NUM_LONG_KINDS 2
+#define LONG_LENGTH 8300
+#define DEFAULT_PAIRS 100
+#define DEFAULT_LENGTH 200
+#define DEFAULT_THREADS 4
+//A run taking longer than this is counted as a hang, in seconds
+#define DEFAULT_TIMEOUT 60
+#define MAX_OUTPUT (1 << 20)
+//Seconds to wait for the server to listen
+#define SERVER_WAIT 5
+//Profile giving Align_Omp the blocked wavefront
+#define BLOCKED_PROFILE "block 16 64 schedule dynamic chunk 2\n"
+
+//One program and the arguments that make it align with the reference scores
+typedef struct {
+	char* binary;       //file name in the binary directory
+	char* args;         //appended after the thread or process count
+	int mode;           //reference the output is checked against
+	int threaded;       //takes a thread or process count
+	char* threadArg;    //fixed count argument, NULL to sweep 1..max threads
+	char* profile;      //engine profile passed with -e, NULL for programs without one
+	int output;
+} Engine;
+
+typedef struct {
+	long score;
+	char* queryRow, * subjectRow;
+} Result;
+
+const int modeFlags[NUM_MODES] = {
+	0,
+	FREE_ALL,
+	FREE_ALL,
+	FREE_QUERY_START | FREE_SUBJECT_END,
+	FREE_SUBJECT_START | FREE_SUBJECT_END,
+	FREE_QUERY_END | FREE_SUBJECT_END,
+};
+
+void makePair(int kind, int maxLength, char** query, char** subject);
+char* randomSequence(int length, const char* alphabet);
+char* mutate(char* seq, int maxLength);
+void modeScores(int mode, int* match, int* mismatch, int* gap);
+long referenceScore(char* query, char* subject, int mode);
+long referenceXdrop(char* query, char* subject);
+pid_t startServer(char* binDir, int numThreads);
+void stopServer(pid_t server);
+int runEngine(char* binDir, Engine* engine, char* threadArg, char* queryFile, char* subjectFile, char* output, int timeout);
+int parseResult(char* output, int format, char* query, char* subject, char* rowBuffer, Result* result);
+int spellCigar(char* cigar, char* query, char* subject, int queryStart, int subjectStart, char* rowBuffer, Result* result);
+int isSpelled(char* seq, char* bases, int freeStart, int freeEnd);
+char* checkResult(Result* result, char* query, char* subject, int mode, long expected);
+void writeFile(char* path, char* seq);
+
+const char* kindNames[] = {"random", "mutated", "homopolymer", "contained", "identical", "single", "disjoint", "seed mismatch",
+	"long identical", "long disjoint"};
+//Socket of the server the client entries talk to and the file the profiles are
+//written to
+char socketPath[] = "/tmp/alignTestSocketXXXXXX";
+char profileFile[] = "/tmp/alignTestProfileXXXXXX";
+
+//Every engine that prints an alignment, Align_Omp runs with a profile of its own so
+//that a profile in the working directory cannot change the engine under test
+Engine engines[] = {
+	{"NeedlemanW", "", GLOBAL, 0, NULL, NULL, BLOCK_OUTPUT},
+	{"NeedlemanW_Omp", "", GLOBAL, 1, NULL, NULL, BLOCK_OUTPUT},
+	{"SmithW", "", LOCAL, 0, NULL, NULL, BLOCK_OUTPUT},
+	{"SmithW_Omp", "", LOCAL, 1, NULL, NULL, BLOCK_OUTPUT},
+	{"Align_Omp", "global -s 4 -1 -5 -w 16", GLOBAL, 1, NULL, "", BLOCK_OUTPUT},
+	{"Align_Omp", "global -s 4 -1 -5 -w 32", GLOBAL, 1, NULL, "", BLOCK_OUTPUT},
+	{"Align_Omp", "global -s 4 -1 -5", GLOBAL, 1, NULL, BLOCKED_PROFILE, BLOCK_OUTPUT},
+	{"Align_Omp", "global -s 4 -1 -5", GLOBAL, 1, "auto", "", BLOCK_OUTPUT},
+	{"Align_Omp", "local -s 2 -2 -5", LOCAL, 1, NULL, "", BLOCK_OUTPUT},
+	{"Align_Omp", "local -s 2 -2 -5 -w 32", LOCAL, 1, NULL, BLOCKED_PROFILE, BLOCK_OUTPUT},
+	{"Align_Omp", "local -s 2 -2 -5", LOCAL, 1, "auto", "", BLOCK_OUTPUT},
+	{"Align_Omp", "semiglobal -s 2 -2 -5", SEMIGLOBAL, 1, NULL, "", BLOCK_OUTPUT},
+	{"Align_Omp", "overlap -s 2 -2 -5", OVERLAP, 1, NULL, "", BLOCK_OUTPUT},
+	{"Align_Omp", "glocal -s 2 -2 -5", GLOCAL, 1, NULL, "", BLOCK_OUTPUT},
+	{"Align_Omp", "xdrop -s 2 -2 -5 -x 5", XDROP, 1, NULL, "", BLOCK_OUTPUT},
+	{"NeedlemanW_Mpi", "", GLOBAL, 1, NULL, NULL, BLOCK_OUTPUT},
+	{"Align_Pipeline", "global -s 4 -1 -5 -f paf", GLOBAL, 1, NULL, NULL, PAF_OUTPUT},
+	{"Align_Pipeline", "local -s 2 -2 -5 -f paf", LOCAL, 1, NULL, NULL, PAF_OUTPUT},
+	{"Align_Pipeline", "glocal -s 2 -2 -5 -f paf", GLOCAL, 1, NULL, NULL, PAF_OUTPUT},
+	{"Align_Server", "global -s 4 -1 -5", GLOBAL, 0, NULL, NULL, REPLY_OUTPUT},
+	{"Align_Server", "local -s 2 -2 -5", LOCAL, 0, NULL, NULL, REPLY_OUTPUT},
+	{"SmithW_Search", "-s 2 -2 -5 -n 1", LOCAL, 1, NULL, NULL, HITS_OUTPUT},
+};
+const int numEngines = sizeof(engines) / sizeof(Engine);
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		printf("Please enter in this format: Align_Test <binary_dir> [-n pairs] [-l max_length] [-L long_length] [-t max_threads] [-r seed] [-T timeout_s] [-k]\n");
+		printf("\tbinary_dir holds NeedlemanW, NeedlemanW_Omp, SmithW, SmithW_Omp, Align_Omp, NeedlemanW_Mpi (fork build), Align_Pipeline, Align_Server and SmithW_Search, missing ones are skipped\n");
+		printf("\tthe first %d pairs are long_length characters long (%d by default), -L 0 leaves them out\n", NUM_LONG_KINDS, LONG_LENGTH);
+		return 1;
+	}
+	char* binDir = argv[1];
+	int numPairs = DEFAULT_PAIRS;
+	int maxLength = DEFAULT_LENGTH;
+	int longLength = LONG_LENGTH;
+	int maxThreads = DEFAULT_THREADS;
+	unsigned int seed = 1;
+	int keepFailures = 0;
+	int timeout = DEFAULT_TIMEOUT;
+	for (int a = 2; a < argc; a++) {
+		if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			numPairs = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-l") == 0 && a + 1 < argc) {
+			maxLength = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-L") == 0 && a + 1 < argc) {
+			longLength = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			maxThreads = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+			seed = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-T") == 0 && a + 1 < argc) {
+			timeout = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-k") == 0) {
+			keepFailures = 1;
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	if (maxLength < 2)
+		maxLength = 2;
+	if (maxThreads < 1)
+		maxThreads = 1;
+	srand(seed);
+
+	//engines whose binary is missing are reported once and skipped
+	int available[sizeof(engines) / sizeof(Engine)];
+	for (int e = 0; e < numEngines; e++) {
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", binDir, engines[e].binary);
+		available[e] = access(path, X_OK) == 0;
+		if (!available[e] && (e == 0 || strcmp(engines[e].binary, engines[e-1].binary) != 0))
+			printf("Skipping %s, not found in %s\n", engines[e].binary, binDir);
+	}
+
+	//the server entries are clients of one server started for the whole run
+	pid_t server = -1;
+	for (int e = 0; e < numEngines; e++) {
+		if (!available[e] || engines[e].output != REPLY_OUTPUT)
+			continue;
+		if (server < 0)
+			server = startServer(binDir, maxThreads);
+		if (server < 0) {
+			available[e] = 0;
+			printf("Skipping %s %s, the server did not start\n", engines[e].binary, engines[e].args);
+		}
+	}
+
+	char queryFile[] = "/tmp/alignTestQueryXXXXXX";
+	char subjectFile[] = "/tmp/alignTestSubjectXXXXXX";
+	close(mkstemp(queryFile));
+	close(mkstemp(subjectFile));
+	close(mkstemp(profileFile));
+	char* output = malloc(MAX_OUTPUT);
+	long numRuns = 0;
+	int numFailures = 0;
+	double initialTime = omp_get_wtime();
+
+	int numLong = longLength > 0 ? NUM_LONG_KINDS : 0;
+	for (int p = 0; p < numPairs; p++) {
+		int kind = p < numLong ? NUM_KINDS + p : (p - numLong) % NUM_KINDS;
+		char* query, * subject;
+		makePair(kind, kind >= NUM_KINDS ? longLength : maxLength, &query, &subject);
+		writeFile(queryFile, query);
+		writeFile(subjectFile, subject);
+		long expected[NUM_MODES];
+		for (int m = 0; m < XDROP; m++)
+			expected[m] = referenceScore(query, subject, m);
+		expected[XDROP] = referenceXdrop(query, subject);
+		//rows spelled out from a CIGAR
+		char* rowBuffer = malloc(2 * (strlen(query) + strlen(subject) + 1));
+		int pairFailed = 0;
+
+		for (int e = 0; e < numEngines; e++) {
+			if (!available[e])
+				continue;
+			Engine* engine = &engines[e];
+			int sweep = engine->threaded && !engine->threadArg ? maxThreads : 1;
+			for (int t = 1; t <= sweep; t++) {
+				char threadArg[16];
+				snprintf(threadArg, sizeof(threadArg), "%d", t);
+				char* count = !engine->threaded ? "" : engine->threadArg ? engine->threadArg : threadArg;
+				char* reason = NULL;
+				Result result;
+				int status = runEngine(binDir, engine, count, queryFile, subjectFile, output, timeout);
+				if (status == 124)
+					reason = "timed out";
+				else if (status != 0)
+					reason = "did not exit cleanly";
+				else if (!parseResult(output, engine->output, query, subject, rowBuffer, &result))
+					reason = "no score or alignment in the output";
+				else
+					reason = checkResult(&result, query, subject, engine->mode, expected[engine->mode]);
+				numRuns++;
+				if (reason) {
+					numFailures++;
+					pairFailed = 1;
+					printf("FAIL %s %s %s, pair %d (%s, %d x %d): %s\n", engine->binary, count, engine->args,
+						p, kindNames[kind], (int)strlen(query), (int)strlen(subject), reason);
+				}
+			}
+		}
+		if (pairFailed && keepFailures) {
+			char path[64];
+			snprintf(path, sizeof(path), "fail_%d_query.txt", p);
+			writeFile(path, query);
+			snprintf(path, sizeof(path), "fail_%d_subject.txt", p);
+			writeFile(path, subject);
+		}
+		free(query);
+		free(subject);
+		free(rowBuffer);
+	}
+	unlink(queryFile);
+	unlink(subjectFile);
+	unlink(profileFile);
+	if (server > 0)
+		stopServer(server);
+
+	printf("\n======================================\n");
+	printf("TEST SUITE FINISHED\n");
+	printf("1) PAIRS: %d (seed %u, up to %d characters)\n", numPairs, seed, maxLength);
+	printf("2) RUNS: %ld (1 to %d threads)\n", numRuns, maxThreads);
+	printf("3) FAILURES: %d\n", numFailures);
+	printf("4) TIME ELAPSED: %fs\n", omp_get_wtime() - initialTime);
+	printf("======================================\n");
+	free(output);
+	return numFailures > 0;
+}
+
+void makePair(int kind, int maxLength, char** query, char** subject) {
+	int length = 1 + rand() % maxLength;
+	if (kind == LONG_IDENTICAL) {
+		*query = randomSequence(maxLength, "ACGT");
+		*subject = strdup(*query);
+	}
+	else if (kind == LONG_DISJOINT) {
+		//shorter, so that the interior cells of a global fill fit in 16 bits and only
+		//the first row and column do not
+		*query = randomSequence(maxLength - maxLength / 8, "A");
+		*subject = randomSequence(maxLength - maxLength / 8, "C");
+	}
+	else if (kind == RANDOM) {
+		*query = randomSequence(length, "ACGT");
+		*subject = randomSequence(1 + rand() % maxLength, "ACGT");
+	}
+	else if (kind == MUTATED) {
+		*query = randomSequence(length, "ACGT");
+		*subject = mutate(*query, maxLength);
+	}
+	else if (kind == HOMOPOLYMER) {
+		*query = malloc(length + 1);
+		for (int k = 0; k < length; k++)
+			(*query)[k] = (k / (1 + length / 4)) % 2 ? 'C' : 'A';
+		(*query)[length] = '\0';
+		*subject = mutate(*query, maxLength);
+	}
+	else if (kind == CONTAINED) {
+		int pieceLength = 1 + rand() % (1 + length / 4);
+		*subject = randomSequence(length, "ACGT");
+		*query = malloc(pieceLength + 1);
+		memcpy(*query, *subject + rand() % (length - pieceLength + 1), pieceLength);
+		(*query)[pieceLength] = '\0';
+		//either side may be the long one
+		if (rand() % 2) {
+			char* temp = *query;
+			*query = *subject;
+			*subject = temp;
+		}
+	}
+	else if (kind == IDENTICAL) {
+		*query = randomSequence(length, "ACGT");
+		*subject = strdup(*query);
+	}
+	else if (kind == SEED_MISMATCH) {
+		*query = randomSequence(length, "ACGT");
+		*subject = mutate(*query, maxLength);
+		(*subject)[0] = (*query)[0] == 'A' ? 'C' : 'A';
+	}
+	else if (kind == SINGLE) {
+		*query = randomSequence(1, "ACGT");
+		*subject = randomSequence(length, "ACGT");
+	}
+	else {
+		*query = randomSequence(length, "AC");
+		*subject = randomSequence(1 + rand() % maxLength, "GT");
+	}
+}
+
+char* randomSequence(int length, const char* alphabet) {
+	int size = strlen(alphabet);
+	char* seq = malloc(length + 1);
+	for (int k = 0; k < length; k++)
+		seq[k] = alphabet[rand() % size];
+	seq[length] = '\0';
+	return seq;
+}
+
+//Copy with about one edit in ten, never empty and never longer than maxLength
+char* mutate(char* seq, int maxLength) {
+	int length = strlen(seq);
+	char* copy = malloc(maxLength + 1);
+	int n = 0;
+	for (int k = 0; k < length && n < maxLength; k++) {
+		int edit = rand() % 30;
+		if (edit == 0)
+			continue;
+		if (edit == 1 && n + 1 < maxLength)
+			copy[n++] = "ACGT"[rand() % 4];
+		copy[n++] = edit == 2 ? "ACGT"[rand() % 4] : seq[k];
+	}
+	if (n == 0)
+		copy[n++] = seq[0];
+	copy[n] = '\0';
+	return copy;
+}
+
+void modeScores(int mode, int* match, int* mismatch, int* gap) {
+	*match = mode == GLOBAL ? NW_MATCH : SW_MATCH;
+	*mismatch = mode == GLOBAL ? NW_MISMATCH : SW_MISMATCH;
+	*gap = mode == GLOBAL ? NW_GAP : SW_GAP;
+}
+
+//Two row score of the optimal alignment in any mode but X-drop. Free starts give the
+//first row or column a score of 0, free ends take the best cell of the last row or
+//column, excluding the first one.
+long referenceScore(char* query, char* subject, int mode) {
+	int local = mode == LOCAL;
+	int flags = modeFlags[mode];
+	int match, mismatch, gap;
+	modeScores(mode, &match, &mismatch, &gap);
+	int rows = strlen(query) + 1;
+	int cols = strlen(subject) + 1;
+	long* prev = malloc(cols * sizeof(long));
+	long* curr = malloc(cols * sizeof(long));
+	long best = 0;
+	long lastColumn = LONG_MIN;
+	for (int j = 0; j < cols; j++)
+		prev[j] = (flags & FREE_SUBJECT_START) ? 0 : (long)j * gap;
+	for (int i = 1; i < rows; i++) {
+		curr[0] = (flags & FREE_QUERY_START) ? 0 : (long)i * gap;
+		for (int j = 1; j < cols; j++) {
+			long score = prev[j-1] + (query[i-1] == subject[j-1] ? match : mismatch);
+			if (prev[j] + gap > score)
+				score = prev[j] + gap;
+			if (curr[j-1] + gap > score)
+				score = curr[j-1] + gap;
+			if (local && score < 0)
+				score = 0;
+			curr[j] = score;
+			if (score > best)
+				best = score;
+		}
+		if (cols > 1 && curr[cols - 1] > lastColumn)
+			lastColumn = curr[cols - 1];
+		long* temp = prev;
+		prev = curr;
+		curr = temp;
+	}
+	long score = local ? best : prev[cols - 1];
+	if (!local && (flags & FREE_QUERY_END) && lastColumn > score)
+		score = lastColumn;
+	for (int j = 1; !local && (flags & FREE_SUBJECT_END) && j < cols; j++) {
+		if (prev[j] > score)
+			score = prev[j];
+	}
+	free(prev);
+	free(curr);
+	return score;
+}
+
+//Best score of X-drop from the top left corner, anti-diagonal by anti-diagonal as a
+//cell is dropped when it scores more than XDROP_LIMIT below the best of the earlier
+//anti-diagonals. Three anti-diagonals indexed by the query row are kept.
+long referenceXdrop(char* query, char* subject) {
+	const long dropped = -(1L << 40);
+	int rows = strlen(query);
+	int cols = strlen(subject);
+	long* diags[3];
+	for (int k = 0; k < 3; k++) {
+		diags[k] = malloc((rows + 1) * sizeof(long));
+		for (int i = 0; i <= rows; i++)
+			diags[k][i] = dropped;
+	}
+	//anti-diagonal d holds cell (i, d - i), d = 0 is the corner
+	diags[0][0] = 0;
+	long best = 0;
+	for (int d = 1; d <= rows + cols; d++) {
+		long* prev2 = diags[(d + 1) % 3];
+		long* prev = diags[(d + 2) % 3];
+		long* curr = diags[d % 3];
+		long cut = best - XDROP_LIMIT;
+		long diagBest = dropped;
+		for (int i = 0; i <= rows; i++) {
+			int j = d - i;
+			long score = dropped;
+			if (j >= 0 && j <= cols) {
+				if (i > 0 && j > 0)
+					score = prev2[i-1] + (query[i-1] == subject[j-1] ? SW_MATCH : SW_MISMATCH);
+				if (i > 0 && prev[i-1] + SW_GAP > score)
+					score = prev[i-1] + SW_GAP;
+				if (j > 0 && prev[i] + SW_GAP > score)
+					score = prev[i] + SW_GAP;
+				if (score < cut)
+					score = dropped;
+			}
+			curr[i] = score;
+			if (score > diagBest)
+				diagBest = score;
+		}
+		if (diagBest > best)
+			best = diagBest;
+	}
+	for (int k = 0; k < 3; k++)
+		free(diags[k]);
+	return best;
+}
+
+//Starts Align_Server on socketPath in the background and waits until it listens.
+//Returns its process id, -1 if it did not start.
+pid_t startServer(char* binDir, int numThreads) {
+	close(mkstemp(socketPath));
+	unlink(socketPath);
+	char path[4096], threads[16];
+	snprintf(path, sizeof(path), "%s/Align_Server", binDir);
+	snprintf(threads, sizeof(threads), "%d", numThreads);
+	fflush(stdout);
+	pid_t server = fork();
+	if (server < 0)
+		return -1;
+	if (server == 0) {
+		freopen("/dev/null", "w", stdout);
+		freopen("/dev/null", "w", stderr);
+		execl(path, "Align_Server", socketPath, threads, (char*)NULL);
+		_exit(127);
+	}
+	for (int k = 0; k < SERVER_WAIT * 100; k++) {
+		if (access(socketPath, F_OK) == 0) {
+			//the socket file is bound before the server listens
+			usleep(100000);
+			return server;
+		}
+		if (waitpid(server, NULL, WNOHANG) == server)
+			return -1;
+		usleep(10000);
+	}
+	kill(server, SIGKILL);
+	waitpid(server, NULL, 0);
+	return -1;
+}
+
+void stopServer(pid_t server) {
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+	unlink(socketPath);
+}
+
+//Runs one engine under timeout(1) and returns its exit status, 124 if it hung
+int runEngine(char* binDir, Engine* engine, char* threadArg, char* queryFile, char* subjectFile, char* output, int timeout) {
+	char command[8192];
+	char profileArg[64] = "";
+	if (engine->profile) {
+		writeFile(profileFile, engine->profile);
+		snprintf(profileArg, sizeof(profileArg), "-e %s", profileFile);
+	}
+	if (engine->output == REPLY_OUTPUT)
+		snprintf(command, sizeof(command), "timeout -s KILL %d %s/%s -c %s %s %s %s 2>&1", timeout, binDir, engine->binary,
+			socketPath, queryFile, subjectFile, engine->args);
+	else
+		snprintf(command, sizeof(command), "timeout -s KILL %d %s/%s %s %s %s %s %s 2>&1", timeout, binDir, engine->binary,
+			queryFile, subjectFile, threadArg, engine->args, profileArg);
+	FILE* fp = popen(command, "r");
+	if (!fp)
+		return -1;
+	long length = fread(output, 1, MAX_OUTPUT - 1, fp);
+	output[length] = '\0';
+	int status = pclose(fp);
+	if (!WIFEXITED(status))
+		return -1;
+	//timeout exits with 137 when the signal was KILL
+	return WEXITSTATUS(status) == 137 ? 124 : WEXITSTATUS(status);
+}
+
+//Finds the score and the query and subject rows in the output of an engine. The
+//rows point into output for the ALIGNMENT STRING block and into rowBuffer when they
+//are spelled out from a CIGAR.
+int parseResult(char* output, int format, char* query, char* subject, char* rowBuffer, Result* result) {
+	int queryStart, subjectStart;
+	char* line;
+	if (format == PAF_OUTPUT || format == HITS_OUTPUT) {
+		line = strstr(output, format == PAF_OUTPUT ? "\tAS:i:" : "\t1. ");
+		//the pipeline and the search leave out alignments scoring 0
+		if (!line) {
+			result->score = 0;
+			result->queryRow = result->subjectRow = "";
+			return strstr(output, "PROGRAM FINISHED") != NULL;
+		}
+		if (format == PAF_OUTPUT) {
+			while (line > output && line[-1] != '\n')
+				line--;
+			if (sscanf(line, "%*s %*d %d %*d %*c %*s %*d %d", &queryStart, &subjectStart) != 2
+				|| sscanf(strstr(line, "AS:i:"), "AS:i:%ld", &result->score) != 1 || !strstr(line, "cg:Z:"))
+				return 0;
+			return spellCigar(strstr(line, "cg:Z:") + strlen("cg:Z:"), query, subject, queryStart, subjectStart, rowBuffer, result);
+		}
+		if (sscanf(line, "\t1. %*s score %ld query %d-%*d subject %d-%*d", &result->score, &queryStart, &subjectStart) != 3
+			|| !strstr(line, " CIGAR "))
+			return 0;
+		return spellCigar(strstr(line, " CIGAR ") + strlen(" CIGAR "), query, subject, queryStart, subjectStart, rowBuffer, result);
+	}
+	line = strstr(output, "FINAL SCORE: ");
+	if (!line || sscanf(line, "FINAL SCORE: %ld", &result->score) != 1)
+		return 0;
+	if (format == REPLY_OUTPUT) {
+		char* start = strstr(output, "QUERY START: ");
+		char* cigar = strstr(output, "CIGAR: ");
+		if (!start || !cigar || sscanf(start, "QUERY START: %d", &queryStart) != 1 || !strstr(start, "SUBJECT START: ")
+			|| sscanf(strstr(start, "SUBJECT START: "), "SUBJECT START: %d", &subjectStart) != 1)
+			return 0;
+		return spellCigar(cigar + strlen("CIGAR: "), query, subject, queryStart, subjectStart, rowBuffer, result);
+	}
+	line = strstr(output, "ALIGNMENT STRING:\n");
+	if (!line)
+		return 0;
+	char* rows[3];
+	line += strlen("ALIGNMENT STRING:\n");
+	for (int r = 0; r < 3; r++) {
+		if (*line != '\t')
+			return 0;
+		rows[r] = ++line;
+		line = strchr(line, '\n');
+		if (!line)
+			return 0;
+		*line++ = '\0';
+	}
+	result->queryRow = rows[0];
+	result->subjectRow = rows[2];
+	return 1;
+}
+
+//Writes the rows of a CIGAR of M, I and D operations starting at the given offsets
+//into rowBuffer. Returns 0 if it runs past the end of a sequence.
+int spellCigar(char* cigar, char* query, char* subject, int queryStart, int subjectStart, char* rowBuffer, Result* result) {
+	int queryLength = strlen(query);
+	int subjectLength = strlen(subject);
+	if (queryStart < 0 || subjectStart < 0)
+		return 0;
+	char* queryRow = rowBuffer;
+	char* subjectRow = rowBuffer + queryLength + subjectLength + 1;
+	int n = 0, q = queryStart, s = subjectStart;
+	while (*cigar >= '0' && *cigar <= '9') {
+		int count = strtol(cigar, &cigar, 10);
+		char op = *cigar++;
+		if (op != 'M' && op != 'I' && op != 'D')
+			return 0;
+		for (int k = 0; k < count; k++) {
+			if ((op != 'D' && q >= queryLength) || (op != 'I' && s >= subjectLength))
+				return 0;
+			queryRow[n] = op == 'D' ? '-' : query[q++];
+			subjectRow[n++] = op == 'I' ? '-' : subject[s++];
+		}
+	}
+	queryRow[n] = '\0';
+	subjectRow[n] = '\0';
+	result->queryRow = queryRow;
+	result->subjectRow = subjectRow;
+	return 1;
+}
+
+//Whether bases is a piece of seq, held to the start or the end unless it is free
+int isSpelled(char* seq, char* bases, int freeStart, int freeEnd) {
+	int length = strlen(seq);
+	int numBases = strlen(bases);
+	if (numBases > length)
+		return 0;
+	if (!freeStart && strncmp(seq, bases, numBases) != 0)
+		return 0;
+	if (!freeEnd && strcmp(seq + length - numBases, bases) != 0)
+		return 0;
+	return freeStart && freeEnd ? strstr(seq, bases) != NULL : 1;
+}
+
+//Returns why the result is wrong, NULL if it is a valid optimal alignment
+char* checkResult(Result* result, char* query, char* subject, int mode, long expected) {
+	static char reason[256];
+	if (result->score != expected) {
+		snprintf(reason, sizeof(reason), "score %ld, reference %ld", result->score, expected);
+		return reason;
+	}
+	int length = strlen(result->queryRow);
+	if ((int)strlen(result->subjectRow) != length)
+		return "alignment rows differ in length";
+
+	int match, mismatch, gap;
+	modeScores(mode, &match, &mismatch, &gap);
+	char* queryBases = malloc(length + 1);
+	char* subjectBases = malloc(length + 1);
+	int numQuery = 0, numSubject = 0;
+	long rescored = 0;
+	char* error = NULL;
+	for (int k = 0; k < length; k++) {
+		char q = result->queryRow[k];
+		char s = result->subjectRow[k];
+		if (q == '-' && s == '-')
+			error = "a column is a gap in both rows";
+		if (q != '-')
+			queryBases[numQuery++] = q;
+		if (s != '-')
+			subjectBases[numSubject++] = s;
+		rescored += q == '-' || s == '-' ? gap : q == s ? match : mismatch;
+	}
+	queryBases[numQuery] = '\0';
+	subjectBases[numSubject] = '\0';
+
+	if (!error && rescored != result->score) {
+		snprintf(reason, sizeof(reason), "alignment rescores to %ld, reported %ld", rescored, result->score);
+		error = reason;
+	}
+	//each row spells its sequence from the first to the last base, except at the ends
+	//the mode leaves free
+	int flags = modeFlags[mode];
+	if (!error && !isSpelled(query, queryBases, flags & FREE_QUERY_START, flags & FREE_QUERY_END))
+		error = "query row does not spell the query";
+	if (!error && !isSpelled(subject, subjectBases, flags & FREE_SUBJECT_START, flags & FREE_SUBJECT_END))
+		error = "subject row does not spell the subject";
+	free(queryBases);
+	free(subjectBases);
+	return error;
+}
+
+void writeFile(char* path, char* seq) {
+	//no newline, the engines read every byte of the file as sequence
+	FILE* fp = fopen(path, "w");
+	if (!fp) {
+		printf("Unable to write %s\n", path);
+		exit(1);
+	}
+	fputs(seq, fp);
+	fclose(fp);
+}
@@ -0,0 +1,100 @@
+//FASTA reader shared by SW_Search, NW_Incremental and Align_Msa. The file holds
+//definitions and is included by one .c file only.
+#ifndef FASTA_H
+#define FASTA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+typedef struct {
+	char* name;
+	char* seq;
+	int length;
+} Record;
+
+int readFasta(char* path, Record** records);
+
+//Reads every record of a FASTA file, a file without a header line is one record
+//named after the file. Whitespace is skipped, every other character is kept as it
+//is, and blank lines before the first record are ignored. Returns the number of
+//records or -1 when the file cannot be read or memory runs out, in which case
+//nothing is left allocated.
+int readFasta(char* path, Record** records) {
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+	int numRecords = 0;
+	int capacity = 16;
+	*records = malloc(capacity * sizeof(Record));
+	Record* current = NULL;
+	int seqCap = 0;
+	char* line = NULL;
+	size_t lineCap = 0;
+	ssize_t n;
+	int failed = *records == NULL;
+	while (!failed && (n = getline(&line, &lineCap, fp)) > 0) {
+		if (current == NULL && line[0] != '>' && strspn(line, " \t\r\n") == (size_t)n)
+			continue;
+		if (line[0] == '>' || current == NULL) {
+			if (numRecords == capacity) {
+				Record* grown = realloc(*records, 2 * capacity * sizeof(Record));
+				if (!grown) {
+					failed = 1;
+					break;
+				}
+				*records = grown;
+				capacity *= 2;
+			}
+			current = &(*records)[numRecords++];
+			if (line[0] == '>') {
+				current->name = strndup(line + 1, strcspn(line + 1, " \t\r\n"));
+			}
+			else {
+				char* slash = strrchr(path, '/');
+				current->name = strdup(slash ? slash + 1 : path);
+			}
+			seqCap = 1024;
+			current->seq = malloc(seqCap);
+			current->length = 0;
+			if (!current->name || !current->seq) {
+				failed = 1;
+				break;
+			}
+			current->seq[0] = '\0';
+			if (line[0] == '>')
+				continue;
+		}
+		for (ssize_t c = 0; c < n; c++) {
+			char base = line[c];
+			if (base == '\n' || base == '\r' || base == ' ' || base == '\t')
+				continue;
+			if (current->length + 1 >= seqCap) {
+				char* grown = realloc(current->seq, 2 * seqCap);
+				if (!grown) {
+					failed = 1;
+					break;
+				}
+				current->seq = grown;
+				seqCap *= 2;
+			}
+			current->seq[current->length++] = base;
+		}
+		current->seq[current->length] = '\0';
+	}
+	free(line);
+	fclose(fp);
+	if (failed) {
+		for (int r = 0; r < numRecords; r++) {
+			free((*records)[r].name);
+			free((*records)[r].seq);
+		}
+		free(*records);
+		*records = NULL;
+		return -1;
+	}
+	return numRecords;
+}
+
+#endif
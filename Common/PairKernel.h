@@ -0,0 +1,439 @@
+//Pairwise alignment kernel shared by NW_Serial, SW_Serial, NW_Omp and SW_Omp.
+//The program defines LOCAL_ALIGNMENT (0 for Needleman-Wunsch, 1 for Smith-Waterman),
+//matchScore, mismatchScore and gapScore before including it, so every difference
+//between the two modes is resolved by the preprocessor and the fill has no branch
+//on the mode. The file holds definitions and is included by one .c file only.
+#ifndef PAIR_KERNEL_H
+#define PAIR_KERNEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(LOCAL_ALIGNMENT) || !defined(matchScore) || !defined(mismatchScore) || !defined(gapScore)
+#error "define LOCAL_ALIGNMENT, matchScore, mismatchScore and gapScore before including PairKernel.h"
+#endif
+
+//Phred qualities of a FASTQ query are grouped in buckets of QUAL_BUCKET_SIZE up to
+//Q40, every bucket has its own match and mismatch score so the fill only reads them
+#define PHRED_OFFSET 33
+#define QUAL_BUCKET_SIZE 5
+#define QUAL_BUCKETS 9
+//With qualities every score is kept in hundredths so the tables still round to
+//different integers up to about Q30, the final score is reported in plain units
+#define QUAL_SCALE 100
+//Define direction constants
+#define PATH -1
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+
+void readFiles(char* queryFile, char* subjectFile);
+int parseFastq(char* data, int size, char** qual);
+void buildScoreTables();
+int qualityBucket(char qual);
+int setupLayout();
+void initialize(int* scoreMatrix, int* tbMatrix);
+int fillChunk(int i, int thread, int numThreads, int* scoreMatrix, int* tbMatrix, int* bestScore, long* bestPos);
+int backtrack(int* tbMatrix, int* scoreMatrix, long endPos, long int* finalScore, char* queryResult, char* subjectResult);
+void printMatrix(int* matrix);
+void printTracebackMatrix(int* matrix);
+void printResults(long int finalScore, double time, int numThreads, char* qrr, char* srr);
+int calcNumDiagRowElements(int i);
+void calcFirstDiagElement(int *i, int *start_i, int *start_j);
+int max(int x, int y);
+int min(int x, int y);
+
+int querySize = 0;
+int subjectSize = 0;
+char* query, * subject;
+//query back to front, so the query characters of an anti-diagonal are read forwards
+char* queryRev;
+//qualities of the query, NULL unless it was a FASTQ read
+char* queryQual = NULL;
+//QUAL_SCALE when the query has qualities, the matrices hold scores times scoreScale
+int scoreScale = 1;
+int matchTable[QUAL_BUCKETS];
+int mismatchTable[QUAL_BUCKETS];
+//match and mismatch score of every query position, back to front like queryRev
+int* matchRev, * mismatchRev;
+//the matrices are stored one anti-diagonal after another, ordered by row, so the
+//cells of a diagonal and of the two before it are contiguous. diagStart[d] is the
+//position of the first cell of anti-diagonal d = i + j
+long* diagStart;
+
+//First row of anti-diagonal d
+static inline int firstRow(int d) {
+	return d < querySize ? 0 : d - querySize + 1;
+}
+
+//Position of cell (i, j) in the anti-diagonal layout
+static inline long cellIndex(int i, int j) {
+	return diagStart[i + j] + i - firstRow(i + j);
+}
+
+//Anti-diagonal d of matrix indexed by row, element i is cell (i, d - i)
+static inline int* diagonal(int* matrix, int d) {
+	return matrix + diagStart[d] - firstRow(d);
+}
+
+//Builds the anti-diagonal offsets and the reversed query with its scores. Called
+//once querySize and subjectSize include the first row and column, returns 0 when
+//out of memory.
+int setupLayout() {
+	diagStart = malloc((long)(querySize + subjectSize) * sizeof(long));
+	queryRev = malloc(querySize);
+	matchRev = malloc(querySize * sizeof(int));
+	mismatchRev = malloc(querySize * sizeof(int));
+	if (!diagStart || !queryRev || !matchRev || !mismatchRev)
+		return 0;
+	diagStart[0] = 0;
+	for (int d = 0; d < querySize + subjectSize - 1; d++)
+		diagStart[d + 1] = diagStart[d] + min(d, subjectSize - 1) - firstRow(d) + 1;
+	if (queryQual)
+		scoreScale = QUAL_SCALE;
+	buildScoreTables();
+	for (int j = 0; j < querySize - 1; j++) {
+		queryRev[j] = query[querySize - 2 - j];
+		int bucket = queryQual ? qualityBucket(queryQual[querySize - 2 - j]) : -1;
+		matchRev[j] = bucket < 0 ? matchScore : matchTable[bucket];
+		mismatchRev[j] = bucket < 0 ? mismatchScore : mismatchTable[bucket];
+	}
+	return 1;
+}
+
+void initialize(int* scoreMatrix, int* tbMatrix) {
+	//only the first row and column are read before the fill writes them, the
+	//interior is left untouched so it is first written by the thread computing it
+	scoreMatrix[0] = 0;
+	tbMatrix[0] = NONE;
+	for (int j=1; j<querySize; j++) {
+		scoreMatrix[cellIndex(0, j)] = LOCAL_ALIGNMENT ? 0 : j * gapScore * scoreScale;
+		tbMatrix[cellIndex(0, j)] = LOCAL_ALIGNMENT ? NONE : LEFT;
+	}
+	for (int i=1; i<subjectSize; i++) {
+		scoreMatrix[cellIndex(i, 0)] = LOCAL_ALIGNMENT ? 0 : i * gapScore * scoreScale;
+		tbMatrix[cellIndex(i, 0)] = LOCAL_ALIGNMENT ? NONE : UP;
+	}
+}
+
+//Computes rows first to last of anti-diagonal d. Up and left are on the previous
+//diagonal and diag on the one before, every access is unit stride so the loop runs
+//in vector registers. Returns the best score of the rows, 0 for a global alignment.
+static inline int fillRows(int d, int first, int last, int* scoreMatrix, int* tbMatrix) {
+	int* curr = diagonal(scoreMatrix, d);
+	int* prev = diagonal(scoreMatrix, d - 1);
+	int* prev2 = diagonal(scoreMatrix, d - 2);
+	int* tb = diagonal(tbMatrix, d);
+	//row r of the diagonal meets query position r + qOff of queryRev, which is in
+	//bounds for every row of it, the pointers are not moved before the arrays
+	int qOff = querySize - 1 - d;
+	int gap = gapScore * scoreScale;
+	int best = 0;
+	#pragma omp simd reduction(max:best)
+	for (int r = first; r <= last; r++) {
+		int up = prev[r-1] + gap;
+		int left = prev[r] + gap;
+		//both scores are loaded so the choice is a select, not a branch
+		int match = matchRev[r + qOff];
+		int mismatch = mismatchRev[r + qOff];
+		int diag = prev2[r-1] + (subject[r-1] == queryRev[r + qOff] ? match : mismatch);
+#if LOCAL_ALIGNMENT
+		//diag, then up, then left, each only if larger than the best so far and 0
+		int max = diag > NONE ? diag : NONE;
+		int pred = diag > NONE ? DIAG : NONE;
+		pred = up > max ? UP : pred;
+		max = up > max ? up : max;
+		pred = left > max ? LEFT : pred;
+		max = left > max ? left : max;
+		best = max > best ? max : best;
+#else
+		//diag over left unless left is larger, then up
+		int max = diag > left ? diag : left;
+		int pred = diag > left ? DIAG : LEFT;
+		pred = up > max ? UP : pred;
+		max = up > max ? up : max;
+#endif
+		curr[r] = max;
+		tb[r] = pred;
+	}
+	return best;
+}
+
+//Computes the share of anti-diagonal i taken by thread out of numThreads. The rows
+//are split in contiguous chunks like a static schedule, so the best cell of a chunk
+//can be kept per thread. A local alignment updates bestScore and bestPos, the
+//row major position of the best cell, with ties going to the first cell in row
+//major order so the result does not depend on the thread schedule. Returns the
+//number of cells on the diagonal.
+int fillChunk(int i, int thread, int numThreads, int* scoreMatrix, int* tbMatrix, int* bestScore, long* bestPos) {
+	int start_i, start_j;
+	int numElements = calcNumDiagRowElements(i);
+	calcFirstDiagElement(&i, &start_i, &start_j);
+	//diagonal i holds the cells with row + column = i + 1, rows start_i - numElements + 1 to start_i
+	int chunk = (numElements + numThreads - 1) / numThreads;
+	int first = start_i - numElements + 1 + thread * chunk;
+	int last = min(start_i, first + chunk - 1);
+	if (first > last)
+		return numElements;
+	int score = fillRows(i + 1, first, last, scoreMatrix, tbMatrix);
+#if LOCAL_ALIGNMENT
+	//on a diagonal the first cell in row major order is the smallest row, only looked
+	//for when the chunk can win
+	if (score > 0 && score >= *bestScore) {
+		int* curr = diagonal(scoreMatrix, i + 1);
+		int row = last;
+		#pragma omp simd reduction(min:row)
+		for (int r = first; r <= last; r++)
+			row = curr[r] == score && r < row ? r : row;
+		long index = (long)querySize * row + i + 1 - row;
+		if (score > *bestScore || index < *bestPos) {
+			*bestScore = score;
+			*bestPos = index;
+		}
+	}
+#else
+	(void)score;
+	(void)bestScore;
+	(void)bestPos;
+#endif
+	return numElements;
+}
+
+//Walks the traceback from endPos, a row major position, back to the cell that
+//starts the alignment: the top left corner for a global alignment, the first cell
+//without a predecessor for a local one, which may be endPos itself when no cell
+//scored above 0. Returns the start of the strings, they are filled from the back.
+int backtrack(int* tbMatrix, int* scoreMatrix, long endPos, long int* finalScore, char* queryResult, char* subjectResult) {
+	int resultSize = querySize + subjectSize - 1;
+	//null terminating the strings, they are filled backwards from here
+	queryResult[resultSize] = '\0';
+	subjectResult[resultSize] = '\0';
+	int i = endPos / querySize;
+	int j = endPos % querySize;
+	long score = scoreMatrix[cellIndex(i, j)];
+	*finalScore = (score + (score < 0 ? -scoreScale : scoreScale) / 2) / scoreScale;
+	while (tbMatrix[cellIndex(i, j)] != NONE) {
+		long index = cellIndex(i, j);
+		if (tbMatrix[index] == DIAG) { //diagonal
+			//record character
+			queryResult[--resultSize] = query[j-1];
+			subjectResult[resultSize] = subject[i-1];
+			i--;
+			j--;
+		}
+		else if (tbMatrix[index] == UP) { //up
+			//insert - at subject string
+			queryResult[--resultSize] = '-';
+			subjectResult[resultSize] = subject[i-1];
+			i--;
+		}
+		else { //left
+			//insert - at query string
+			queryResult[--resultSize] = query[j-1];
+			subjectResult[resultSize] = '-';
+			j--;
+		}
+		tbMatrix[index] *= PATH;
+	}
+	return resultSize;
+}
+
+int calcNumDiagRowElements(int i) {
+    if (i < querySize && i < subjectSize) {
+        //Number of elements in the diagonal is increasing
+        return i;
+    }
+    else if (i < max(querySize, subjectSize)) {
+        //Number of elements in the diagonal is stable
+        int size = min(querySize, subjectSize);
+        return size - 1;
+    }
+    else {
+        //Number of elements in the diagonal is decreasing
+        int size = min(querySize, subjectSize);
+        return 2 * size - i + abs(querySize - subjectSize) - 2;
+    }
+}
+
+void calcFirstDiagElement(int *i, int *start_i, int *start_j) {
+    // Calculate the first element of diagonal
+    //rows are the subject and columns the query, querySize is the row stride
+    if (*i < subjectSize) {
+        *start_i = *i;
+        *start_j = 1;
+    } else {
+        *start_i = subjectSize - 1;
+        *start_j = *i - subjectSize + 2;
+    }
+}
+
+void printMatrix(int* matrix) {
+    int i, j;
+	printf("\nSimilarity Matrix:\n");
+    for (i = 0; i < subjectSize; i++) { //Lines
+        for (j = 0; j < querySize; j++) {
+            printf("%d\t", matrix[cellIndex(i, j)]);
+        }
+        printf("\n");
+    }
+}
+
+void printTracebackMatrix(int* matrix) {
+    int i, j;
+    long index;
+    for (i = 0; i < subjectSize; i++) { //Lines
+        for (j = 0; j < querySize; j++) {
+            index = cellIndex(i, j);
+            if(matrix[index] < 0) {
+                if (matrix[index] == -UP)
+                    printf("U ");
+                else if (matrix[index] == -LEFT)
+                    printf("L ");
+                else if (matrix[index] == -DIAG)
+                    printf("D ");
+                else
+                	printf("- ");
+            }
+            else {
+            	printf("- ");
+            }
+        }
+        printf("\n");
+    }
+}
+
+//numThreads is 0 for the serial programs, which leave out the thread count
+void printResults(long int finalScore, double time, int numThreads, char* qrr, char* srr) {
+	//bar marking matches, mismatches and gaps between the two strings
+	int length = strlen(qrr);
+	char* matchBar = malloc(length + 1);
+	for (int i=0; i<length; i++) {
+		if ((qrr[i] == '-') | (srr[i] == '-')) {
+			matchBar[i] = ' ';
+		}
+		else if (qrr[i] == srr[i]) {
+			matchBar[i] = '|';
+		}
+		else {
+			matchBar[i] = '*';
+		}
+	}
+	matchBar[length] = '\0';
+	int line = 5;
+	printf("\n======================================\n");
+	printf("PROGRAM FINISHED\n");
+	printf("Analyzed query string of %d and subject string of %d\n", querySize-1, subjectSize-1);
+	printf("1) FINAL SCORE: %ld\n", finalScore);
+	printf("2) ALIGNMENT STRING SIZE: %d\n", length);
+	printf("3) ALIGNMENT STRING:\n");
+	printf("\t%s\n\t%s\n\t%s\n", qrr, matchBar, srr);
+	printf("4) TIME ELAPSED: %fs\n", time);
+	if (numThreads > 0)
+		printf("%d) NUMBER OF THREADS USED: %d\n", line++, numThreads);
+	if (queryQual)
+		printf("%d) QUALITY SCORING: %d buckets of %d from the FASTQ query, scored in 1/%d units\n", line++, QUAL_BUCKETS, QUAL_BUCKET_SIZE, QUAL_SCALE);
+	printf("======================================\n");
+	free(matchBar);
+}
+
+int max(int x, int y) {
+	if (x > y)
+		return x;
+	else
+		return y;
+}
+
+int min(int x, int y) {
+	if (x > y)
+		return y;
+	else
+		return x;
+}
+
+void readFiles(char* queryFile, char* subjectFile) {
+	FILE* qfp = fopen(queryFile, "r");
+	FILE* sfp = fopen(subjectFile, "r");
+
+	if (qfp) {
+		fseek(qfp, 0, SEEK_END);
+		querySize = ftell(qfp);
+		fseek(qfp, 0, SEEK_SET);
+		query = malloc(querySize);
+		if (query) {
+			fread(query, 1, querySize, qfp);
+		}
+		fclose(qfp);
+	}
+
+	if (sfp) {
+		fseek(sfp, 0, SEEK_END);
+		subjectSize = ftell(sfp);
+		fseek(sfp, 0, SEEK_SET);
+		subject = malloc(subjectSize);
+		if (subject) {
+			fread(subject, 1, subjectSize, sfp);
+		}
+		fclose(sfp);
+	}
+
+	//FASTQ input keeps the sequence of its first record, the qualities of the
+	//subject are not used
+	if (query && querySize > 0 && query[0] == '@')
+		querySize = parseFastq(query, querySize, &queryQual);
+	if (subject && subjectSize > 0 && subject[0] == '@')
+		subjectSize = parseFastq(subject, subjectSize, NULL);
+}
+
+//Moves the sequence of the first FASTQ record to the front of data and copies its
+//quality line to qual when qual is not NULL. Returns the sequence length.
+int parseFastq(char* data, int size, char** qual) {
+	int lineStart[4], lineEnd[4];
+	int pos = 0;
+	for (int l = 0; l < 4; l++) {
+		lineStart[l] = pos;
+		while (pos < size && data[pos] != '\n')
+			pos++;
+		lineEnd[l] = pos;
+		if (lineEnd[l] > lineStart[l] && data[lineEnd[l] - 1] == '\r')
+			lineEnd[l]--;
+		pos++;
+	}
+	int length = max(0, lineEnd[1] - lineStart[1]);
+	if (qual) {
+		//bases without a quality are trusted like the plain scores
+		*qual = malloc(length + 1);
+		int qualLength = max(0, min(length, lineEnd[3] - lineStart[3]));
+		memcpy(*qual, data + lineStart[3], qualLength);
+		memset(*qual + qualLength, PHRED_OFFSET + 40, length - qualLength);
+		(*qual)[length] = '\0';
+	}
+	memmove(data, data + lineStart[1], length);
+	return length;
+}
+
+//Expected score of a match and of a mismatch seen at the middle quality of each
+//bucket. With error probability e a seen match is real with probability 1 - e and
+//a seen mismatch hides the subject base with e / 3. The tables are times
+//QUAL_SCALE like every score of a run with qualities.
+void buildScoreTables() {
+	for (int b = 0; b < QUAL_BUCKETS; b++) {
+		int q = min(b * QUAL_BUCKET_SIZE + QUAL_BUCKET_SIZE / 2, 40);
+		//e = 10^(-q/10)
+		double e = 1;
+		for (int k = 0; k < q; k++)
+			e *= 0.7943282347242815;
+		double match = QUAL_SCALE * (matchScore * (1 - e) + mismatchScore * e);
+		double mismatch = QUAL_SCALE * (mismatchScore * (1 - e / 3) + matchScore * e / 3);
+		matchTable[b] = (int)(match + (match < 0 ? -0.5 : 0.5));
+		mismatchTable[b] = (int)(mismatch + (mismatch < 0 ? -0.5 : 0.5));
+	}
+}
+
+int qualityBucket(char qual) {
+	int q = max(0, qual - PHRED_OFFSET);
+	return min(q / QUAL_BUCKET_SIZE, QUAL_BUCKETS - 1);
+}
+
+#endif
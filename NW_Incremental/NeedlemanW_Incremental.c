@@ -0,0 +1,441 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+
+#include "../Common/Fasta.h"
+
+//Piece of a row whose scores are all shifted by the same amount
+typedef struct {
+	int start;    //first column of the run
+	int offset;   //added to the stored scores of the run
+} Run;
+
+//One cached row of the matrix, the score of column j is score[j] plus the offset of
+//the run holding j. Rows that only shifted since the last version keep their stored
+//scores and get new offsets instead of being rewritten.
+typedef struct {
+	int* score;
+	char* tb;
+	Run* runs;
+	int numRuns;
+} Row;
+
+void newRow(Row* row);
+void freeRow(Row* row);
+void initializeRow0(Row* row);
+void computeRow(int i, int* above, int* out, char* tb);
+void expandRow(Row* row, int* out);
+long int fullAlign(char* newQuery, int newLength);
+long int incrementalAlign(char* newQuery, int newLength);
+int updateRow(Row* prevRow, Row* row, int i, int* D, int* prevBreaks, int numPrevBreaks, int* breaks, int* processed, long int* cells);
+void setRuns(Row* row, int* D, int* breaks, int numBreaks);
+long int finalScore(void);
+char* traceback(void);
+int prependCigarOp(char* cigar, int start, char op, int length);
+
+//Default scores of the NW programs, can be overridden from the command line
+int matchScore = 4;
+int mismatchScore = -1;
+int gapScore = -5;
+
+//Matrix of the last aligned version, rows are the query and columns the subject
+int querySize = 0;
+int subjectSize = 0;
+char* query, * subject;
+Row* rows = NULL;
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		printf("Please enter in this format: needleW_Incremental <query_versions_fasta> <subject_file_name> [-n] [-s match mismatch gap]\n");
+		printf("\tthe first record is aligned in full, every later record is re-aligned from the matrix of the one before\n");
+		printf("\t-n recompute every version from scratch for comparison\n");
+		return 1;
+	}
+	int incremental = 1;
+	for (int a = 3; a < argc; a++) {
+		if (strcmp(argv[a], "-n") == 0)
+			incremental = 0;
+		else if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+			matchScore = atoi(argv[++a]);
+			mismatchScore = atoi(argv[++a]);
+			gapScore = atoi(argv[++a]);
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	Record* versions, * subjects;
+	int numVersions = readFasta(argv[1], &versions);
+	int numSubjects = readFasta(argv[2], &subjects);
+	if (numVersions < 1 || numSubjects < 1) {
+		printf("Unable to read %s or %s\n", argv[1], argv[2]);
+		return 1;
+	}
+	subject = subjects[0].seq;
+	subjectSize = subjects[0].length + 1;
+
+	printf("\n======================================\n");
+	printf("PROGRAM FINISHED\n");
+	printf("Aligned %d versions of the query against subject string of %d%s\n", numVersions, subjectSize - 1,
+		incremental ? "" : " from scratch");
+	double totalTime = 0;
+	long int totalCells = 0, totalMatrix = 0;
+	for (int v = 0; v < numVersions; v++) {
+		double initialTime = omp_get_wtime();
+		long int cells;
+		if (v == 0 || !incremental)
+			cells = fullAlign(versions[v].seq, versions[v].length);
+		else
+			cells = incrementalAlign(versions[v].seq, versions[v].length);
+		long int score = finalScore();
+		char* cigar = traceback();
+		double timeElapsed = omp_get_wtime() - initialTime;
+		long int matrix = (long int)(querySize - 1) * (subjectSize - 1);
+		totalTime += timeElapsed;
+		totalCells += cells;
+		totalMatrix += matrix;
+		printf("%d) %s: FINAL SCORE: %ld CELLS COMPUTED: %ld (%.2f%% of matrix) TIME: %fs\n", v + 1, versions[v].name,
+			score, cells, matrix > 0 ? 100.0 * cells / matrix : 0.0, timeElapsed);
+		printf("\tCIGAR: %s\n", cigar[0] ? cigar : "*");
+		free(cigar);
+	}
+	printf("TOTAL CELLS COMPUTED: %ld (%.2f%% of matrix)\n", totalCells, totalMatrix > 0 ? 100.0 * totalCells / totalMatrix : 0.0);
+	printf("TOTAL TIME ELAPSED: %fs\n", totalTime);
+	printf("======================================\n");
+	return 0;
+}
+
+void newRow(Row* row) {
+	row->score = malloc(subjectSize * sizeof(int));
+	row->tb = malloc(subjectSize);
+	row->runs = malloc(sizeof(Run));
+	if (!row->score || !row->tb || !row->runs) {
+		printf("Unable to allocate a row of %d\n", subjectSize - 1);
+		exit(1);
+	}
+	row->runs[0].start = 0;
+	row->runs[0].offset = 0;
+	row->numRuns = 1;
+}
+
+void freeRow(Row* row) {
+	free(row->score);
+	free(row->tb);
+	free(row->runs);
+}
+
+void initializeRow0(Row* row) {
+	row->score[0] = 0;
+	row->tb[0] = NONE;
+	for (int j = 1; j < subjectSize; j++) {
+		row->score[j] = j * gapScore;
+		row->tb[j] = LEFT;
+	}
+}
+
+//Fills row i from the full scores of the row above
+void computeRow(int i, int* above, int* out, char* tb) {
+	char q = query[i-1];
+	out[0] = i * gapScore;
+	tb[0] = UP;
+	for (int j = 1; j < subjectSize; j++) {
+		int max = above[j-1] + (q == subject[j-1] ? matchScore : mismatchScore);
+		int pred = DIAG;
+		if (out[j-1] + gapScore > max) {
+			max = out[j-1] + gapScore;
+			pred = LEFT;
+		}
+		if (above[j] + gapScore > max) {
+			max = above[j] + gapScore;
+			pred = UP;
+		}
+		out[j] = max;
+		tb[j] = pred;
+	}
+}
+
+void expandRow(Row* row, int* out) {
+	for (int r = 0; r < row->numRuns; r++) {
+		int end = r + 1 < row->numRuns ? row->runs[r + 1].start : subjectSize;
+		for (int j = row->runs[r].start; j < end; j++)
+			out[j] = row->score[j] + row->runs[r].offset;
+	}
+}
+
+//Offset of column j, cursor remembers the run so increasing columns are found in order
+static inline int offsetAt(Row* row, int j, int* cursor) {
+	while (*cursor + 1 < row->numRuns && row->runs[*cursor + 1].start <= j)
+		(*cursor)++;
+	return row->runs[*cursor].offset;
+}
+
+long int fullAlign(char* newQuery, int newLength) {
+	if (rows) {
+		for (int i = 0; i < querySize; i++)
+			freeRow(&rows[i]);
+		free(rows);
+	}
+	query = newQuery;
+	querySize = newLength + 1;
+	rows = malloc(querySize * sizeof(Row));
+	if (!rows) {
+		printf("Unable to allocate %d rows\n", querySize);
+		exit(1);
+	}
+	newRow(&rows[0]);
+	initializeRow0(&rows[0]);
+	for (int i = 1; i < querySize; i++) {
+		newRow(&rows[i]);
+		computeRow(i, rows[i-1].score, rows[i].score, rows[i].tb);
+	}
+	return (long int)(querySize - 1) * (subjectSize - 1);
+}
+
+//Re-aligns after the query changed. Rows above the first edit are kept, the rows of
+//the edited stretch are computed, and below it each row is the cached row of the same
+//query character shifted by the edit. There D is the change of every column since the
+//cached version. A cell whose three predecessors changed by the same amount changes by
+//that amount too and keeps its traceback, so only cells next to a column where D
+//steps are recomputed. Once D is the same across a row nothing is recomputed below it.
+long int incrementalAlign(char* newQuery, int newLength) {
+	int oldLength = querySize - 1;
+	int shorter = oldLength < newLength ? oldLength : newLength;
+	int prefix = 0;
+	while (prefix < shorter && query[prefix] == newQuery[prefix])
+		prefix++;
+	int suffix = 0;
+	while (prefix + suffix < shorter && query[oldLength - 1 - suffix] == newQuery[newLength - 1 - suffix])
+		suffix++;
+	int delta = newLength - oldLength;
+	long int cells = 0;
+
+	Row* newRows = malloc((newLength + 1) * sizeof(Row));
+	int* above = malloc(subjectSize * sizeof(int));
+	int* D = malloc(subjectSize * sizeof(int));
+	int* breaks = malloc(subjectSize * sizeof(int));
+	int* prevBreaks = malloc(subjectSize * sizeof(int));
+	int* processed = malloc(subjectSize * sizeof(int));
+	if (!newRows || !above || !D || !breaks || !prevBreaks || !processed) {
+		printf("Unable to allocate the incremental buffers\n");
+		exit(1);
+	}
+	for (int i = 0; i <= prefix; i++)
+		newRows[i] = rows[i];
+	//rows of the old edited stretch are no longer part of the matrix
+	for (int i = prefix + 1; i <= oldLength - suffix; i++)
+		freeRow(&rows[i]);
+	query = newQuery;
+	querySize = newLength + 1;
+
+	//edited stretch from scratch
+	int* aboveScores = above;
+	expandRow(&newRows[prefix], above);
+	for (int i = prefix + 1; i <= newLength - suffix; i++) {
+		newRow(&newRows[i]);
+		computeRow(i, aboveScores, newRows[i].score, newRows[i].tb);
+		aboveScores = newRows[i].score;
+		cells += subjectSize - 1;
+	}
+
+	if (suffix > 0) {
+		//first shifted row in full, this gives D for every column
+		int first = newLength - suffix + 1;
+		Row* row = &rows[first - delta];
+		int* current = malloc(subjectSize * sizeof(int));
+		expandRow(row, D);
+		computeRow(first, aboveScores, current, row->tb);
+		int numBreaks = 0;
+		for (int j = 0; j < subjectSize; j++) {
+			D[j] = current[j] - D[j];
+			if (j > 0 && D[j] != D[j-1])
+				breaks[numBreaks++] = j;
+		}
+		free(current);
+		setRuns(row, D, breaks, numBreaks);
+		newRows[first] = *row;
+		cells += subjectSize - 1;
+
+		for (int i = first + 1; i <= newLength; i++) {
+			int* temp = prevBreaks;
+			prevBreaks = breaks;
+			breaks = temp;
+			row = &rows[i - delta];
+			numBreaks = updateRow(&newRows[i-1], row, i, D, prevBreaks, numBreaks, breaks, processed, &cells);
+			setRuns(row, D, breaks, numBreaks);
+			newRows[i] = *row;
+		}
+	}
+
+	free(rows);
+	rows = newRows;
+	free(above);
+	free(D);
+	free(breaks);
+	free(prevBreaks);
+	free(processed);
+	return cells;
+}
+
+//Brings the cached row up to date for query row i. On entry D holds the change of the
+//row above and prevBreaks the columns where it steps, on return D and breaks hold the
+//same for this row.
+int updateRow(Row* prevRow, Row* row, int i, int* D, int* prevBreaks, int numPrevBreaks, int* breaks, int* processed, long int* cells) {
+	char q = query[i-1];
+	int numProcessed = 0;
+	int prevCursor = 0, rowCursor = 0;
+	int bp = 0;
+	int j = 1;
+	while (j < subjectSize) {
+		while (bp < numPrevBreaks && prevBreaks[bp] < j)
+			bp++;
+		//D[j-1] already belongs to this row, D[j] still to the row above
+		int dirty = (bp < numPrevBreaks && prevBreaks[bp] == j) || D[j-1] != D[j];
+		if (!dirty) {
+			//nothing changes until the next step of the row above
+			if (bp == numPrevBreaks)
+				break;
+			j = prevBreaks[bp];
+			continue;
+		}
+		int diag = prevRow->score[j-1] + offsetAt(prevRow, j-1, &prevCursor);
+		int up = prevRow->score[j] + offsetAt(prevRow, j, &prevCursor);
+		int left = row->score[j-1] + offsetAt(row, j-1, &rowCursor) + D[j-1];
+		int cached = row->score[j] + offsetAt(row, j, &rowCursor);
+		int max = diag + (q == subject[j-1] ? matchScore : mismatchScore);
+		int pred = DIAG;
+		if (left + gapScore > max) {
+			max = left + gapScore;
+			pred = LEFT;
+		}
+		if (up + gapScore > max) {
+			max = up + gapScore;
+			pred = UP;
+		}
+		row->tb[j] = pred;
+		D[j] = max - cached;
+		processed[numProcessed++] = j;
+		j++;
+	}
+	*cells += numProcessed;
+
+	//D can only step where the row above stepped or next to a recomputed cell
+	int numBreaks = 0;
+	int a = 0, b = 0, c = 0;
+	int last = 0;
+	for (;;) {
+		int next = subjectSize;
+		if (a < numPrevBreaks && prevBreaks[a] < next)
+			next = prevBreaks[a];
+		if (b < numProcessed && processed[b] < next)
+			next = processed[b];
+		if (c < numProcessed && processed[c] + 1 < next)
+			next = processed[c] + 1;
+		if (next >= subjectSize)
+			break;
+		if (next > last && D[next] != D[next-1])
+			breaks[numBreaks++] = next;
+		last = next;
+		while (a < numPrevBreaks && prevBreaks[a] <= next)
+			a++;
+		while (b < numProcessed && processed[b] <= next)
+			b++;
+		while (c < numProcessed && processed[c] + 1 <= next)
+			c++;
+	}
+	return numBreaks;
+}
+
+//Replaces the offsets of a cached row by its old offsets plus D, merging equal neighbours
+void setRuns(Row* row, int* D, int* breaks, int numBreaks) {
+	Run* runs = malloc((row->numRuns + numBreaks + 1) * sizeof(Run));
+	int numRuns = 0;
+	int cursor = 0;
+	int r = 0, b = 0;
+	int x = 0;
+	for (;;) {
+		int offset = offsetAt(row, x, &cursor) + D[x];
+		if (numRuns == 0 || runs[numRuns - 1].offset != offset) {
+			runs[numRuns].start = x;
+			runs[numRuns].offset = offset;
+			numRuns++;
+		}
+		//next column where either the old offsets or D step
+		while (r < row->numRuns && row->runs[r].start <= x)
+			r++;
+		while (b < numBreaks && breaks[b] <= x)
+			b++;
+		int next = subjectSize;
+		if (r < row->numRuns)
+			next = row->runs[r].start;
+		if (b < numBreaks && breaks[b] < next)
+			next = breaks[b];
+		if (next >= subjectSize)
+			break;
+		x = next;
+	}
+	free(row->runs);
+	row->runs = runs;
+	row->numRuns = numRuns;
+}
+
+long int finalScore(void) {
+	Row* last = &rows[querySize - 1];
+	int cursor = 0;
+	return last->score[subjectSize - 1] + offsetAt(last, subjectSize - 1, &cursor);
+}
+
+//Walks the traceback from the bottom right corner and returns the CIGAR
+char* traceback(void) {
+	int cigarStart = 2 * (querySize + subjectSize);
+	char* cigar = malloc(cigarStart + 1);
+	cigar[cigarStart] = '\0';
+	int i = querySize - 1;
+	int j = subjectSize - 1;
+	char runOp = 0;
+	int runLength = 0;
+	while (rows[i].tb[j] != NONE) {
+		char op;
+		if (rows[i].tb[j] == DIAG) {
+			op = 'M';
+			i--;
+			j--;
+		}
+		else if (rows[i].tb[j] == UP) { //query base against a gap
+			op = 'I';
+			i--;
+		}
+		else { //subject base against a gap
+			op = 'D';
+			j--;
+		}
+		if (op != runOp) {
+			cigarStart = prependCigarOp(cigar, cigarStart, runOp, runLength);
+			runOp = op;
+			runLength = 0;
+		}
+		runLength++;
+	}
+	cigarStart = prependCigarOp(cigar, cigarStart, runOp, runLength);
+	memmove(cigar, cigar + cigarStart, strlen(cigar + cigarStart) + 1);
+	return cigar;
+}
+
+int prependCigarOp(char* cigar, int start, char op, int length) {
+	if (length == 0)
+		return start;
+	cigar[--start] = op;
+	do {
+		cigar[--start] = '0' + length % 10;
+		length /= 10;
+	} while (length > 0);
+	return start;
+}
+
@@ -0,0 +1,687 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#ifdef USE_MPI
+#include <mpi.h>
+#else
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+//define scores
+#define matchScore 4
+#define mismatchScore -1
+#define gapScore -5
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//rows computed between two boundary messages to the next process
+#define DEFAULT_BLOCK_ROWS 256
+//message tags
+#define TAG_BOUNDARY 1
+#define TAG_CROSSING 2
+#define TAG_SEGMENT 3
+#define TAG_SCORE 4
+
+void readFiles(char* queryFile, char* subjectFile);
+void launchProcesses();
+void sendBytes(int dest, int tag, void* buf, long int bytes);
+void recvBytes(int src, int tag, void* buf, long int bytes);
+void stripeBounds(int r, int* firstCol, int* lastCol);
+long int forwardPass(int* leftColumn);
+int findCrossing(int* leftColumn, int endRow, int* move, long int* total);
+void tracebackStripe(int* leftColumn);
+void gatherSegments();
+void hirschberg(int rowFrom, int rowTo, int colFrom, int colTo);
+void forwardScores(int rowFrom, int rowTo, int colFrom, int colTo, int* row);
+void reverseScores(int rowFrom, int rowTo, int colFrom, int colTo, int* row);
+void alignSmall(int rowFrom, int rowTo, int colFrom, int colTo);
+void appendPair(char q, char s);
+void printResults(long int finalScore, double time, int numProcs, char* qrr, char* srr);
+int matchMismatchScore(char a, char b);
+int max(int x, int y);
+int min(int x, int y);
+
+int querySize = 0;
+int subjectSize = 0;
+char* query, * subject;
+int rank = 0;
+int numProcs = 1;
+int blockRows = DEFAULT_BLOCK_ROWS;
+//this process' columns of the matrix, inclusive
+int firstCol, lastCol;
+//this process' piece of the alignment, and the whole alignment on rank 0
+char* queryResult, * subjectResult;
+long int resultLength = 0;
+//rows reused by every level of the hirschberg recursion
+int* forwardRow, * reverseRow;
+#ifndef USE_MPI
+//pipe between each pair of processes that talk, -1 when unused
+int* pipeFds;
+#endif
+
+int main(int argc, char* argv[]) {
+#ifdef USE_MPI
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &numProcs);
+	int numPositional = 2;
+#else
+	int numPositional = 3;
+#endif
+	int scoreOnly = 0;
+	int argi = numPositional + 1;
+	while (argi < argc) {
+		if (strcmp(argv[argi], "-b") == 0 && argi + 1 < argc) {
+			blockRows = atoi(argv[argi + 1]);
+			argi += 2;
+		}
+		else if (strcmp(argv[argi], "-c") == 0) {
+			scoreOnly = 1;
+			argi++;
+		}
+		else {
+			break;
+		}
+	}
+	if (argc <= numPositional || argi != argc || blockRows < 1) {
+		if (rank == 0) {
+#ifdef USE_MPI
+			printf("Please enter in this format: mpirun -np <num_processes> needleW_Mpi <query_file_name> <subject_file_name> [-b block_rows] [-c]\n");
+#else
+			printf("Please enter in this format: needleW_Mpi <query_file_name> <subject_file_name> <num_processes> [-b block_rows] [-c]\n");
+#endif
+			printf("\t-b rows computed between boundary messages (default %d)\n", DEFAULT_BLOCK_ROWS);
+			printf("\t-c score only, skip the traceback\n");
+		}
+#ifdef USE_MPI
+		MPI_Finalize();
+#endif
+		return 1;
+	}
+	readFiles(argv[1], argv[2]);
+	if (querySize == 0) {
+		if (rank == 0) {
+			printf("Query must not be empty\n");
+		}
+#ifdef USE_MPI
+		MPI_Finalize();
+#endif
+		return 1;
+	}
+#ifndef USE_MPI
+	numProcs = atoi(argv[3]);
+	if (numProcs < 1) {
+		numProcs = 1;
+	}
+	//forked processes are ours to choose, never start more than there are columns
+	if (numProcs > querySize) {
+		numProcs = querySize;
+	}
+#endif
+	//every process needs at least one column of its own
+	if (numProcs > querySize) {
+		if (rank == 0) {
+			printf("Cannot split a query of %d into %d stripes\n", querySize, numProcs);
+		}
+#ifdef USE_MPI
+		MPI_Finalize();
+#endif
+		return 1;
+	}
+
+	//increment to add in 1 row and column
+	querySize++;
+	subjectSize++;
+
+	double initialTime = omp_get_wtime();
+#ifdef USE_MPI
+	MPI_Barrier(MPI_COMM_WORLD);
+	initialTime = MPI_Wtime();
+#else
+	launchProcesses();
+#endif
+	stripeBounds(rank, &firstCol, &lastCol);
+
+	//the column just left of the stripe, received from the previous process
+	int* leftColumn = malloc(subjectSize * sizeof(int));
+	if (leftColumn == NULL) {
+		fprintf(stderr, "Process %d: out of memory for the boundary column\n", rank);
+		exit(1);
+	}
+	long int finalScore = forwardPass(leftColumn);
+	if (!scoreOnly) {
+		tracebackStripe(leftColumn);
+		gatherSegments();
+	}
+	//the score is only known to the last process, it goes to rank 0 last
+	if (numProcs > 1 && rank == numProcs - 1) {
+		sendBytes(0, TAG_SCORE, &finalScore, sizeof(long int));
+	}
+	else if (numProcs > 1 && rank == 0) {
+		recvBytes(numProcs - 1, TAG_SCORE, &finalScore, sizeof(long int));
+	}
+
+	if (rank == 0) {
+#ifdef USE_MPI
+		double timeElapsed = MPI_Wtime() - initialTime;
+#else
+		double timeElapsed = omp_get_wtime() - initialTime;
+#endif
+		if (scoreOnly) {
+			queryResult = "";
+			subjectResult = "";
+		}
+		printResults(finalScore, timeElapsed, numProcs, queryResult, subjectResult);
+	}
+	free(leftColumn);
+
+#ifdef USE_MPI
+	MPI_Finalize();
+#else
+	if (rank == 0) {
+		while (wait(NULL) > 0);
+	}
+	else {
+		fflush(stdout);
+		_exit(0);
+	}
+#endif
+	return 0;
+}
+
+void stripeBounds(int r, int* first, int* last) {
+	//columns 1..querySize-1 are split as evenly as possible
+	int cols = querySize - 1;
+	*first = 1 + (int)((long int)r * cols / numProcs);
+	*last = (int)((long int)(r + 1) * cols / numProcs);
+}
+
+long int forwardPass(int* leftColumn) {
+	//only two rows of the stripe are kept, the score in the last column of
+	//each row is passed on to the next process once per block of rows
+	int width = lastCol - firstCol + 1;
+	int* prevRow = malloc((width + 1) * sizeof(int));
+	int* currRow = malloc((width + 1) * sizeof(int));
+	int* boundary = malloc(blockRows * sizeof(int));
+	if (prevRow == NULL || currRow == NULL || boundary == NULL) {
+		fprintf(stderr, "Process %d: out of memory for the stripe rows\n", rank);
+		exit(1);
+	}
+	for (int x = 0; x <= width; x++) {
+		prevRow[x] = (firstCol - 1 + x) * gapScore;
+	}
+	leftColumn[0] = prevRow[0];
+
+	for (int blockStart = 1; blockStart < subjectSize; blockStart += blockRows) {
+		int blockEnd = min(blockStart + blockRows, subjectSize);
+		if (rank == 0) {
+			for (int i = blockStart; i < blockEnd; i++) {
+				leftColumn[i] = i * gapScore;
+			}
+		}
+		else {
+			recvBytes(rank - 1, TAG_BOUNDARY, leftColumn + blockStart, (long int)(blockEnd - blockStart) * sizeof(int));
+		}
+		for (int i = blockStart; i < blockEnd; i++) {
+			char s = subject[i - 1];
+			currRow[0] = leftColumn[i];
+			for (int x = 1; x <= width; x++) {
+				int diag = prevRow[x - 1] + matchMismatchScore(query[firstCol + x - 2], s);
+				int left = currRow[x - 1] + gapScore;
+				int up = prevRow[x] + gapScore;
+				currRow[x] = max(max(diag, left), up);
+			}
+			boundary[i - blockStart] = currRow[width];
+			int* temp = prevRow;
+			prevRow = currRow;
+			currRow = temp;
+		}
+		if (rank < numProcs - 1) {
+			sendBytes(rank + 1, TAG_BOUNDARY, boundary, (long int)(blockEnd - blockStart) * sizeof(int));
+		}
+	}
+	long int score = prevRow[width];
+	free(prevRow);
+	free(currRow);
+	free(boundary);
+	return score;
+}
+
+int findCrossing(int* leftColumn, int endRow, int* move, long int* total) {
+	//scores backwards from the end cell over the stripe to find where the
+	//path enters it from the column on its left, one row of scores at a time
+	int width = lastCol - firstCol + 1;
+	int* row = malloc((width + 2) * sizeof(int));
+	if (row == NULL) {
+		fprintf(stderr, "Process %d: out of memory for the crossing search\n", rank);
+		exit(1);
+	}
+	for (int x = 1; x <= width; x++) {
+		row[x] = (width - x) * gapScore;
+	}
+	int bestRow = endRow;
+	*move = LEFT;
+	*total = (long int)leftColumn[endRow] + gapScore + row[1];
+	for (int k = endRow - 1; k >= 0; k--) {
+		char s = subject[k];
+		//row still holds row k+1 here, which a diagonal move from column firstCol-1 lands in
+		long int diagTotal = (long int)leftColumn[k] + matchMismatchScore(query[firstCol - 1], s) + row[1];
+		int below = row[width];
+		row[width] = below + gapScore;
+		for (int x = width - 1; x >= 1; x--) {
+			int diagBelow = below;
+			below = row[x];
+			int diag = diagBelow + matchMismatchScore(query[firstCol + x - 1], s);
+			row[x] = max(max(diag, row[x + 1] + gapScore), below + gapScore);
+		}
+		long int leftTotal = (long int)leftColumn[k] + gapScore + row[1];
+		if (diagTotal > *total) {
+			*total = diagTotal;
+			bestRow = k;
+			*move = DIAG;
+		}
+		if (leftTotal > *total) {
+			*total = leftTotal;
+			bestRow = k;
+			*move = LEFT;
+		}
+	}
+	free(row);
+	return bestRow;
+}
+
+void tracebackStripe(int* leftColumn) {
+	//the last process ends in the bottom right corner, every other process
+	//ends on the row where the path left it for the next stripe
+	int endRow = subjectSize - 1;
+	if (rank < numProcs - 1) {
+		recvBytes(rank + 1, TAG_CROSSING, &endRow, sizeof(int));
+	}
+	int move;
+	long int total;
+	int crossRow = findCrossing(leftColumn, endRow, &move, &total);
+	if (rank > 0) {
+		sendBytes(rank - 1, TAG_CROSSING, &crossRow, sizeof(int));
+	}
+
+	long int maxLength = (long int)(lastCol - firstCol + 1) + endRow + 1;
+	if (rank == 0) {
+		maxLength += crossRow;
+	}
+	queryResult = malloc(maxLength + 1);
+	subjectResult = malloc(maxLength + 1);
+	int width = lastCol - firstCol + 1;
+	forwardRow = malloc((width + 1) * sizeof(int));
+	reverseRow = malloc((width + 1) * sizeof(int));
+	if (queryResult == NULL || subjectResult == NULL || forwardRow == NULL || reverseRow == NULL) {
+		fprintf(stderr, "Process %d: out of memory for the traceback\n", rank);
+		exit(1);
+	}
+	resultLength = 0;
+	//the first process also owns column 0, walked down to the crossing row
+	if (rank == 0) {
+		for (int i = 0; i < crossRow; i++) {
+			appendPair('-', subject[i]);
+		}
+	}
+	int rowFrom = crossRow;
+	if (move == DIAG) {
+		appendPair(query[firstCol - 1], subject[crossRow]);
+		rowFrom++;
+	}
+	else {
+		appendPair(query[firstCol - 1], '-');
+	}
+	hirschberg(rowFrom, endRow, firstCol, lastCol);
+	free(forwardRow);
+	free(reverseRow);
+}
+
+void gatherSegments() {
+	//rank 0 appends the pieces of the other processes in stripe order
+	if (rank > 0) {
+		sendBytes(0, TAG_SEGMENT, &resultLength, sizeof(long int));
+		sendBytes(0, TAG_SEGMENT, queryResult, resultLength);
+		sendBytes(0, TAG_SEGMENT, subjectResult, resultLength);
+		free(queryResult);
+		free(subjectResult);
+		return;
+	}
+	long int totalLength = (long int)querySize + subjectSize;
+	queryResult = realloc(queryResult, totalLength);
+	subjectResult = realloc(subjectResult, totalLength);
+	if (queryResult == NULL || subjectResult == NULL) {
+		fprintf(stderr, "Process 0: out of memory for the alignment\n");
+		exit(1);
+	}
+	for (int r = 1; r < numProcs; r++) {
+		long int length;
+		recvBytes(r, TAG_SEGMENT, &length, sizeof(long int));
+		recvBytes(r, TAG_SEGMENT, queryResult + resultLength, length);
+		recvBytes(r, TAG_SEGMENT, subjectResult + resultLength, length);
+		resultLength += length;
+	}
+	queryResult[resultLength] = '\0';
+	subjectResult[resultLength] = '\0';
+}
+
+void hirschberg(int rowFrom, int rowTo, int colFrom, int colTo) {
+	//aligns subject[rowFrom..rowTo) with query[colFrom..colTo) in linear space
+	//by splitting the subject in half and finding where the path crosses it
+	int rows = rowTo - rowFrom;
+	int cols = colTo - colFrom;
+	if (rows == 0) {
+		for (int j = colFrom; j < colTo; j++) {
+			appendPair(query[j], '-');
+		}
+		return;
+	}
+	if (cols == 0) {
+		for (int i = rowFrom; i < rowTo; i++) {
+			appendPair('-', subject[i]);
+		}
+		return;
+	}
+	if (rows == 1 || cols == 1) {
+		alignSmall(rowFrom, rowTo, colFrom, colTo);
+		return;
+	}
+	int rowMid = rowFrom + rows / 2;
+	forwardScores(rowFrom, rowMid, colFrom, colTo, forwardRow);
+	reverseScores(rowMid, rowTo, colFrom, colTo, reverseRow);
+	int split = 0;
+	long int best = (long int)forwardRow[0] + reverseRow[0];
+	for (int x = 1; x <= cols; x++) {
+		long int sum = (long int)forwardRow[x] + reverseRow[x];
+		if (sum > best) {
+			best = sum;
+			split = x;
+		}
+	}
+	hirschberg(rowFrom, rowMid, colFrom, colFrom + split);
+	hirschberg(rowMid, rowTo, colFrom + split, colTo);
+}
+
+void forwardScores(int rowFrom, int rowTo, int colFrom, int colTo, int* row) {
+	//row[x] is the best score of subject[rowFrom..rowTo) against query[colFrom..colFrom+x)
+	int cols = colTo - colFrom;
+	for (int x = 0; x <= cols; x++) {
+		row[x] = x * gapScore;
+	}
+	for (int i = rowFrom; i < rowTo; i++) {
+		int diag = row[0];
+		row[0] += gapScore;
+		for (int x = 1; x <= cols; x++) {
+			int up = row[x];
+			row[x] = max(max(diag + matchMismatchScore(query[colFrom + x - 1], subject[i]), row[x - 1] + gapScore), up + gapScore);
+			diag = up;
+		}
+	}
+}
+
+void reverseScores(int rowFrom, int rowTo, int colFrom, int colTo, int* row) {
+	//row[x] is the best score of subject[rowFrom..rowTo) against query[colFrom+x..colTo)
+	int cols = colTo - colFrom;
+	for (int x = cols; x >= 0; x--) {
+		row[x] = (cols - x) * gapScore;
+	}
+	for (int i = rowTo - 1; i >= rowFrom; i--) {
+		int diag = row[cols];
+		row[cols] += gapScore;
+		for (int x = cols - 1; x >= 0; x--) {
+			int down = row[x];
+			row[x] = max(max(diag + matchMismatchScore(query[colFrom + x], subject[i]), row[x + 1] + gapScore), down + gapScore);
+			diag = down;
+		}
+	}
+}
+
+void alignSmall(int rowFrom, int rowTo, int colFrom, int colTo) {
+	//full matrix for the base case, one of the two sides is a single character
+	int rows = rowTo - rowFrom + 1;
+	int cols = colTo - colFrom + 1;
+	int* scoreMatrix = malloc(rows * cols * sizeof(int));
+	char* tbMatrix = malloc(rows * cols);
+	char* queryPiece = malloc(rows + cols);
+	char* subjectPiece = malloc(rows + cols);
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < cols; j++) {
+			int index = cols * i + j;
+			if (i == 0 && j == 0) {
+				scoreMatrix[index] = 0;
+				tbMatrix[index] = NONE;
+			}
+			else if (i == 0) {
+				scoreMatrix[index] = j * gapScore;
+				tbMatrix[index] = LEFT;
+			}
+			else if (j == 0) {
+				scoreMatrix[index] = i * gapScore;
+				tbMatrix[index] = UP;
+			}
+			else {
+				int diag = scoreMatrix[index - cols - 1] + matchMismatchScore(query[colFrom + j - 1], subject[rowFrom + i - 1]);
+				int left = scoreMatrix[index - 1] + gapScore;
+				int up = scoreMatrix[index - cols] + gapScore;
+				//same preference as NeedlemanW_Omp
+				if (diag > left) {
+					scoreMatrix[index] = diag;
+					tbMatrix[index] = DIAG;
+				}
+				else {
+					scoreMatrix[index] = left;
+					tbMatrix[index] = LEFT;
+				}
+				if (up > scoreMatrix[index]) {
+					scoreMatrix[index] = up;
+					tbMatrix[index] = UP;
+				}
+			}
+		}
+	}
+	int pieceStart = rows + cols;
+	int i = rows - 1;
+	int j = cols - 1;
+	while (i > 0 || j > 0) {
+		int dir = tbMatrix[cols * i + j];
+		pieceStart--;
+		if (dir == DIAG) {
+			queryPiece[pieceStart] = query[colFrom + j - 1];
+			subjectPiece[pieceStart] = subject[rowFrom + i - 1];
+			i--;
+			j--;
+		}
+		else if (dir == LEFT) {
+			queryPiece[pieceStart] = query[colFrom + j - 1];
+			subjectPiece[pieceStart] = '-';
+			j--;
+		}
+		else {
+			queryPiece[pieceStart] = '-';
+			subjectPiece[pieceStart] = subject[rowFrom + i - 1];
+			i--;
+		}
+	}
+	for (int k = pieceStart; k < rows + cols; k++) {
+		appendPair(queryPiece[k], subjectPiece[k]);
+	}
+	free(scoreMatrix);
+	free(tbMatrix);
+	free(queryPiece);
+	free(subjectPiece);
+}
+
+void appendPair(char q, char s) {
+	queryResult[resultLength] = q;
+	subjectResult[resultLength] = s;
+	resultLength++;
+}
+
+#ifdef USE_MPI
+void sendBytes(int dest, int tag, void* buf, long int bytes) {
+	MPI_Send(buf, (int)bytes, MPI_BYTE, dest, tag, MPI_COMM_WORLD);
+}
+
+void recvBytes(int src, int tag, void* buf, long int bytes) {
+	MPI_Recv(buf, (int)bytes, MPI_BYTE, src, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+#else
+void launchProcesses() {
+	//stands in for mpirun on one machine, neighbours get a pipe each way and
+	//every process gets one to rank 0, messages between a pair stay in order
+	pipeFds = malloc(numProcs * numProcs * 2 * sizeof(int));
+	for (int src = 0; src < numProcs; src++) {
+		for (int dest = 0; dest < numProcs; dest++) {
+			int* fds = pipeFds + 2 * (numProcs * src + dest);
+			fds[0] = fds[1] = -1;
+			if (src != dest && (abs(src - dest) == 1 || dest == 0)) {
+				if (pipe(fds) != 0) {
+					perror("pipe");
+					exit(1);
+				}
+			}
+		}
+	}
+	//a write to a process that died fails with an error instead of killing the writer
+	signal(SIGPIPE, SIG_IGN);
+	fflush(stdout);
+	for (int r = 1; r < numProcs; r++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			exit(1);
+		}
+		if (pid == 0) {
+			rank = r;
+			break;
+		}
+	}
+	//every process keeps only the read ends of the pipes to it and the write ends of
+	//the pipes from it, so a read sees end of file as soon as its peer exits
+	for (int src = 0; src < numProcs; src++) {
+		for (int dest = 0; dest < numProcs; dest++) {
+			int* fds = pipeFds + 2 * (numProcs * src + dest);
+			if (fds[0] >= 0 && dest != rank) {
+				close(fds[0]);
+				fds[0] = -1;
+			}
+			if (fds[1] >= 0 && src != rank) {
+				close(fds[1]);
+				fds[1] = -1;
+			}
+		}
+	}
+}
+
+void sendBytes(int dest, int tag, void* buf, long int bytes) {
+	(void)tag;
+	int fd = pipeFds[2 * (numProcs * rank + dest) + 1];
+	char* p = buf;
+	while (bytes > 0) {
+		ssize_t n = write(fd, p, bytes);
+		if (n <= 0) {
+			perror("write");
+			exit(1);
+		}
+		p += n;
+		bytes -= n;
+	}
+}
+
+void recvBytes(int src, int tag, void* buf, long int bytes) {
+	(void)tag;
+	int fd = pipeFds[2 * (numProcs * src + rank)];
+	char* p = buf;
+	while (bytes > 0) {
+		ssize_t n = read(fd, p, bytes);
+		if (n <= 0) {
+			fprintf(stderr, "Process %d: lost process %d\n", rank, src);
+			exit(1);
+		}
+		p += n;
+		bytes -= n;
+	}
+}
+#endif
+
+void printResults(long int finalScore, double time, int numProcs, char* qrr, char* srr) {
+	//bar marking matches, mismatches and gaps between the two strings
+	long int length = strlen(qrr);
+	char* matchBar = malloc(length + 1);
+	for (long int i=0; i<length; i++) {
+		if ((qrr[i] == '-') | (srr[i] == '-')) {
+			matchBar[i] = ' ';
+		}
+		else if (qrr[i] == srr[i]) {
+			matchBar[i] = '|';
+		}
+		else {
+			matchBar[i] = '*';
+		}
+	}
+	matchBar[length] = '\0';
+	printf("\n======================================\n");
+	printf("PROGRAM FINISHED\n");
+	printf("Analyzed query and subject string of %d\n", querySize-1);
+	printf("1) FINAL SCORE: %ld\n", finalScore);
+	printf("2) ALIGNMENT STRING SIZE: %ld\n", length);
+	printf("3) ALIGNMENT STRING:\n");
+	printf("\t%s\n\t%s\n\t%s\n", qrr, matchBar, srr);
+	printf("4) TIME ELAPSED: %fs\n", time);
+	printf("5) NUMBER OF PROCESSES USED: %d\n", numProcs);
+	printf("======================================\n");
+	free(matchBar);
+}
+
+int matchMismatchScore(char a, char b) {
+	if (a == b)
+		return matchScore;
+	else
+		return mismatchScore;
+}
+
+int max(int x, int y) {
+	if (x > y)
+		return x;
+	else
+		return y;
+}
+
+int min(int x, int y) {
+	if (x > y)
+		return y;
+	else
+		return x;
+}
+
+void readFiles(char* queryFile, char* subjectFile) {
+	FILE* qfp = fopen(queryFile, "r");
+	FILE* sfp = fopen(subjectFile, "r");
+
+	if (qfp) {
+		fseek(qfp, 0, SEEK_END);
+		querySize = ftell(qfp);
+		fseek(qfp, 0, SEEK_SET);
+		query = malloc(querySize);
+		if (query) {
+			fread(query, 1, querySize, qfp);
+		}
+		fclose(qfp);
+	}
+
+	if (sfp) {
+		fseek(sfp, 0, SEEK_END);
+		subjectSize = ftell(sfp);
+		fseek(sfp, 0, SEEK_SET);
+		subject = malloc(subjectSize);
+		if (subject) {
+			fread(subject, 1, subjectSize, sfp);
+		}
+		fclose(sfp);
+	}
+}
@@ -1,322 +1,156 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <signal.h>
 #include <omp.h>
 
 //define scores
+#define LOCAL_ALIGNMENT 0
 #define matchScore 4
 #define mismatchScore -1
 #define gapScore -5
-//Define direction constants
-#define PATH -1
-#define NONE 0
-#define UP 1
-#define LEFT 2
-#define DIAG 3
+//Seconds between progress reports unless -p says otherwise, 0 turns them off
+#define PROGRESS_INTERVAL 1.0
 
-void readFiles(char* queryFile, char* subjectFile);
-void similarityScore(int i, int j, int* scoreMatrix, int* tbMatrix);
-void backtrack(int* tbMatrix, int* scoreMatrix, long int* finalScore, char* queryResultReverse, char* subjectResultReverse);
-void printMatrix(int* matrix);
-void printTracebackMatrix(int* matrix);
-void printResults(long int finalScore, double time, int numThreads, char* qrr, char* srr);
-int matchMismatchScore(int i, int j);
-int max(int x, int y);
-int min(int x, int y);
-void initialize(int *scoreMatrix);
-int calcNumDiagRowElements(int i);
-void calcFirstDiagElement(int *i, int *start_i, int *start_j);
+#include "../Common/PairKernel.h"
 
-int querySize = 0;
-int subjectSize = 0;
-char* query, * subject;
+//Progress hook, called by the master thread between anti-diagonals at most every
+//progressInterval seconds. A nonzero return cancels the fill.
+typedef int (*ProgressCallback)(int diagonalsDone, int numDiag, long cellsDone, double elapsed);
+
+int printProgress(int diagonalsDone, int numDiag, long cellsDone, double elapsed);
+void requestCancel(int sig);
+
+ProgressCallback progressCallback = printProgress;
+double progressInterval = PROGRESS_INTERVAL;
+//set by SIGINT and SIGTERM, the fill stops at the next anti-diagonal
+volatile sig_atomic_t cancelRequested = 0;
 
 int main(int argc, char* argv[]) {
-	if (argc != 4) {
-		printf("Please enter in this format: needleW <query_file_name> <subject_file_name> <num_threads>\n");
+	if (argc != 4 && !(argc == 6 && strcmp(argv[4], "-p") == 0)) {
+		printf("Please enter in this format: needleW <query_file_name> <subject_file_name> <num_threads> [-p progress_seconds]\n");
+		printf("\tprogress goes to stderr every second by default, -p 0 turns it off. SIGINT or SIGTERM cancel the fill,\n");
+		printf("\twhich prints PROGRAM CANCELLED instead of an alignment and exits with status 2\n");
 		return 1;
 	}
 	char* queryFile = argv[1];
 	char* subjectFile = argv[2];
 	int thread_count = atoi(argv[3]);
+	if (argc == 6)
+		progressInterval = atof(argv[5]);
+	if (progressInterval <= 0)
+		progressCallback = NULL;
 	readFiles(queryFile, subjectFile);
 
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestCancel;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
 
 	//increment to add in 1 row and column
 	querySize++;
 	subjectSize++;
 
+	//offsets of the anti-diagonals and the reversed query
+	if (!setupLayout()) {
+		printf("Unable to allocate matrices for %d x %d\n", querySize - 1, subjectSize - 1);
+		return 1;
+	}
+
 	//allocate flattened score matrix
-	int *scoreMatrix = malloc(querySize * subjectSize * sizeof(int));
-	int *tbMatrix = malloc(querySize * subjectSize * sizeof(int));
+	int *scoreMatrix = malloc((long)querySize * subjectSize * sizeof(int));
+	int *tbMatrix = malloc((long)querySize * subjectSize * sizeof(int));
 
 	//initialize variables
 	long int finalScore = 0;
 	int numThreads = 0;
-	int start_i, start_j, diag_i, diag_j, numElements;
 	int numDiag = querySize + subjectSize - 3;
-	//temporary allocation of string
-	char* queryResultReverse = malloc(querySize*2);
-	char* subjectResultReverse = malloc(subjectSize*2);
+	//progress of the fill, kept by the master thread
+	int diagonalsDone = 0;
+	long cellsDone = 0;
+	//first anti-diagonal not computed, lowered when the fill is cancelled
+	int stopDiag = INT_MAX;
+	//alignment strings are filled from the back, both sequences plus the terminator at most
+	char* queryResult = malloc(querySize + subjectSize);
+	char* subjectResult = malloc(querySize + subjectSize);
+	if (!scoreMatrix || !tbMatrix || !queryResult || !subjectResult) {
+		printf("Unable to allocate matrices for %d x %d, %.1f MB needed\n", querySize - 1, subjectSize - 1,
+			2.0 * querySize * subjectSize * sizeof(int) / (1024 * 1024));
+		return 1;
+	}
 	//initialize matrix first row and column
-	initialize(scoreMatrix);
+	initialize(scoreMatrix, tbMatrix);
 
 	double initialTime = omp_get_wtime();
+	double nextReport = initialTime + progressInterval;
 
 	#pragma omp parallel num_threads(thread_count) \
-	default(none) shared(scoreMatrix, tbMatrix, subjectSize, querySize, numThreads, numDiag) \
-	private(numElements, start_i, start_j, diag_i, diag_j)
+	default(none) shared(scoreMatrix, tbMatrix, numThreads, numDiag, diagonalsDone, \
+	cellsDone, stopDiag, cancelRequested, progressCallback, progressInterval, initialTime, nextReport)
 	{
+		#pragma omp single
 		numThreads = omp_get_num_threads();
+		int thread = omp_get_thread_num();
 		for (int i=1; i <= numDiag; i++) {
-			numElements = calcNumDiagRowElements(i);
-			calcFirstDiagElement(&i, &start_i, &start_j);
-			#pragma omp for
-			for (int j=1; j<= numElements; j++) {
-				diag_i = start_i- j + 1;
-				diag_j = start_j + j -1;
-				similarityScore(diag_i, diag_j, scoreMatrix, tbMatrix);
+			//the master lowers stopDiag to two diagonals ahead, so a barrier always
+			//separates the write from the read and every thread leaves at the same i
+			int stop;
+			#pragma omp atomic read
+			stop = stopDiag;
+			if (i >= stop)
+				break;
+			int numElements = fillChunk(i, thread, numThreads, scoreMatrix, tbMatrix, NULL, NULL);
+			#pragma omp barrier
+			#pragma omp master
+			{
+				diagonalsDone = i;
+				cellsDone += numElements;
+				int cancel = cancelRequested;
+				if (!cancel && progressCallback && omp_get_wtime() >= nextReport) {
+					cancel = progressCallback(i, numDiag, cellsDone, omp_get_wtime() - initialTime);
+					nextReport = omp_get_wtime() + progressInterval;
+				}
+				if (cancel && stopDiag == INT_MAX) {
+					#pragma omp atomic write
+					stopDiag = i + 2;
+				}
 			}
 		}
 	}
-	backtrack(tbMatrix, scoreMatrix, &finalScore, queryResultReverse, subjectResultReverse);
+	if (diagonalsDone < numDiag) {
+		//a cancelled fill has no alignment, the banner says so on stdout and the exit
+		//status is 2 so callers can tell it from a failure, which exits with 1
+		fprintf(stderr, "Cancelled after %d of %d anti-diagonals (%.1f%%), %.3f GCUPS\n", diagonalsDone, numDiag,
+			100.0 * diagonalsDone / numDiag, cellsDone / (omp_get_wtime() - initialTime) / 1e9);
+		printf("\n======================================\n");
+		printf("PROGRAM CANCELLED\n");
+		printf("Analyzed query string of %d and subject string of %d\n", querySize-1, subjectSize-1);
+		printf("1) ANTI-DIAGONALS COMPUTED: %d of %d, no alignment\n", diagonalsDone, numDiag);
+		printf("======================================\n");
+		return 2;
+	}
+	int resultStart = backtrack(tbMatrix, scoreMatrix, (long)querySize * subjectSize - 1, &finalScore, queryResult, subjectResult);
 
 
 	double finalTime = omp_get_wtime();
 	double timeElapsed = finalTime-initialTime;
-	printResults(finalScore, timeElapsed, numThreads, queryResultReverse, subjectResultReverse);
+	printResults(finalScore, timeElapsed, numThreads, queryResult + resultStart, subjectResult + resultStart);
 	//printMatrix(scoreMatrix);
 	//printTracebackMatrix(tbMatrix);
 
 }
 
-int calcNumDiagRowElements(int i) {
-    if (i < querySize && i < subjectSize) {
-        //Number of elements in the diagonal is increasing
-        return i;
-    }
-    else if (i < max(querySize, subjectSize)) {
-        //Number of elements in the diagonal is stable
-        int size = min(querySize, subjectSize);
-        return size - 1;
-    }
-    else {
-        //Number of elements in the diagonal is decreasing
-        int size = min(querySize, subjectSize);
-        return 2 * size - i + abs(querySize - subjectSize) - 2;
-    }
-}
-
-void calcFirstDiagElement(int *i, int *start_i, int *start_j) {
-    // Calculate the first element of diagonal
-    if (*i < querySize) {
-        *start_i = *i;
-        *start_j = 1;
-    } else {
-        *start_i = querySize - 1;
-        *start_j = *i - querySize + 2;
-    }
-}
-
-void similarityScore(int i, int j, int* scoreMatrix, int* tbMatrix) {
-    int up, left, diag;
-
-    int index = querySize * i + j;
-
-    //Get element above
-    up = scoreMatrix[index-querySize] + gapScore;
-
-    //Get element on the left
-    left = scoreMatrix[index-1] + gapScore;
-
-    //Get element on the diagonal
-    diag = scoreMatrix[index-querySize-1] + matchMismatchScore(i, j);
-
-    //Calculates the maximum
-    int max;
-    int pred;
-    if (diag > left) {
-    	max = diag;
-    	pred = DIAG;
-    }
-    else {
-    	max = left;
-    	pred = LEFT;
-    }
-    if (up > max) {
-    	max = up;
-    	pred = UP;
-    }
-    //Inserts the value in the similarity and traceback matrixes
-    scoreMatrix[index] = max;
-    tbMatrix[index] = pred;
-}
-
-void backtrack(int* tbMatrix, int* scoreMatrix, long int* finalScore, char* queryResultReverse, char* subjectResultReverse) {
-    int predPos;
-	int resultSize = 0;
-	//start from bottom right corner
-	int currPos = querySize*subjectSize-1;
-    *finalScore = scoreMatrix[currPos];
-    //backtrack from btm right corner to top left corner
-    do {
-        if (tbMatrix[currPos] == DIAG) { //diagonal
-            predPos = currPos - querySize - 1;
-            //record character
-            queryResultReverse[resultSize] = query[(currPos%querySize)-1];
-            subjectResultReverse[resultSize++] = subject[((currPos-1)/querySize)-1];
-        }
-        else if (tbMatrix[currPos] == UP) { //up
-            predPos = currPos - querySize;
-            //insert - at subject string
-            queryResultReverse[resultSize] = '-';
-            subjectResultReverse[resultSize++] = subject[((currPos-1)/querySize)-1];
-        }
-        else if (tbMatrix[currPos] == LEFT) { //left
-            predPos = currPos - 1;
-            //insert - at query string
-            queryResultReverse[resultSize] = query[(currPos%querySize)-1];
-            subjectResultReverse[resultSize++] = '-';
-        }
-        tbMatrix[currPos] *= PATH;
-        currPos = predPos;
-
-    } while (currPos > 0);
-    //null terminating the strings
-    queryResultReverse[resultSize] = '\0';
-    subjectResultReverse[resultSize] = '\0';
-}
-
-void initialize(int* scoreMatrix) {
-	int i,j;
-
-	for (i=0; i<querySize; i++) {
-		for (j=0; j<subjectSize; j++) {
-			int index = querySize * i + j;
-			if (i==0 && j==0) {
-				scoreMatrix[index] = 0;
-			}
-			else if (i==0) {
-				scoreMatrix[index] = scoreMatrix[index-1] + gapScore;
-			}
-			else if (j==0) {
-				scoreMatrix[index] = scoreMatrix[index-querySize] + gapScore;
-			}
-			else {
-				scoreMatrix[index] = 0;
-			}
-		}
-	}
-}
-
-void printMatrix(int* matrix) {
-    int i, j;
-	printf("\nSimilarity Matrix:\n");
-    for (i = 0; i < querySize; i++) { //Lines
-        for (j = 0; j < subjectSize; j++) {
-            printf("%d\t", matrix[subjectSize * i +j ]);
-        }
-        printf("\n");
-    }
-}
-
-void printTracebackMatrix(int* matrix) {
-    int i, j, index;
-    for (i = 0; i < querySize; i++) { //Lines
-        for (j = 0; j < subjectSize; j++) {
-            index = querySize * i + j;
-            if(matrix[index] < 0) {
-                if (matrix[index] == -UP)
-                    printf("U ");
-                else if (matrix[index] == -LEFT)
-                    printf("L ");
-                else if (matrix[index] == -DIAG)
-                    printf("D ");
-                else
-                	printf("- ");
-            }
-            else {
-            	printf("- ");
-            }
-        }
-        printf("\n");
-    }
-}
-
-void printResults(long int finalScore, double time, int numThreads, char* qrr, char* srr) {
-	//reverse both strings
-	strrev(qrr);
-	strrev(srr);
-	printf("\n======================================\n");
-	printf("PROGRAM FINISHED\n");
-	printf("Analyzed query and subject string of %d\n", querySize-1);
-	printf("1) FINAL SCORE: %ld\n", finalScore);
-	printf("2) ALIGNMENT STRING SIZE: %d\n", strlen(qrr));
-	printf("3) ALIGNMENT STRING:\n");
-	printf("\t%s\n", qrr);
-	printf("\t");
-	for (int i=0; i<strlen(qrr); i++) {
-		if ((qrr[i] == '-') | (srr[i] == '-')) {
-			printf(" ");
-		}
-		else if (qrr[i] == srr[i]) {
-			printf("|");
-		}
-		else {
-			printf("*");
-		}
-	}
-	printf("\n\t%s\n", srr);
-	printf("4) TIME ELAPSED: %fs\n", time);
-	printf("5) NUMBER OF THREADS USED: %d\n", numThreads);
-	printf("======================================\n");
-}
-
-int matchMismatchScore(int i, int j) {
-	if (subject[i-1] == query[j-1])
-        return matchScore;
-    else
-        return mismatchScore;
-}
-
-int max(int x, int y) {
-	if (x > y)
-		return x;
-	else
-		return y;
-}
-
-int min(int x, int y) {
-	if (x > y)
-		return y;
-	else
-		return x;
+int printProgress(int diagonalsDone, int numDiag, long cellsDone, double elapsed) {
+	fprintf(stderr, "PROGRESS: %.1f%% of %d anti-diagonals, %.3f GCUPS, %.1fs\n", 100.0 * diagonalsDone / numDiag, numDiag,
+		cellsDone / elapsed / 1e9, elapsed);
+	return 0;
 }
 
-void readFiles(char* queryFile, char* subjectFile) {
-	FILE* qfp = fopen(queryFile, "r");
-	FILE* sfp = fopen(subjectFile, "r");
-
-	if (qfp) {
-		fseek(qfp, 0, SEEK_END);
-		querySize = ftell(qfp);
-		fseek(qfp, 0, SEEK_SET);
-		query = malloc(querySize);
-		if (query) {
-			fread(query, 1, querySize, qfp);
-		}
-		fclose(qfp);
-	}
-
-	if (sfp) {
-		fseek(sfp, 0, SEEK_END);
-		subjectSize = ftell(sfp);
-		fseek(sfp, 0, SEEK_SET);
-		subject = malloc(subjectSize);
-		if (subject) {
-			fread(subject, 1, subjectSize, sfp);
-		}
-		fclose(sfp);
-	}
+void requestCancel(int sig) {
+	(void)sig;
+	cancelRequested = 1;
 }
 
@@ -4,31 +4,12 @@
 #include <omp.h>
 
 //define scores
+#define LOCAL_ALIGNMENT 0
 #define matchScore 4
 #define mismatchScore -1
 #define gapScore -5
-//Define direction constants
-#define PATH -1
-#define NONE 0
-#define UP 1
-#define LEFT 2
-#define DIAG 3
 
-void readFiles(char* queryFile, char* subjectFile);
-void similarityScore(int i, int j, int* scoreMatrix, int* tbMatrix);
-void backtrack(int* tbMatrix, int* scoreMatrix, long int* finalScore, char* queryResultReverse, char* subjectResultReverse);
-void printMatrix(int* matrix);
-void printTracebackMatrix(int* matrix);
-void printResults(long int finalScore, double time, char* qrr, char* srr);
-int matchMismatchScore(int i, int j);
-int max(int x, int y);
-void initialize(int *scoreMatrix);
-
-
-int querySize = 0;
-int subjectSize = 0;
-
-char* query, * subject;
+#include "../Common/PairKernel.h"
 
 int main(int argc, char* argv[]) {
 	if (argc != 3) {
@@ -43,226 +24,41 @@ int main(int argc, char* argv[]) {
 	querySize++;
 	subjectSize++;
 
+	//offsets of the anti-diagonals and the reversed query
+	if (!setupLayout()) {
+		printf("Unable to allocate matrices for %d x %d\n", querySize - 1, subjectSize - 1);
+		return 1;
+	}
+
 	//allocate flattened score matrix
-	int *scoreMatrix = malloc(querySize * subjectSize * sizeof(int));
-	int *tbMatrix = malloc(querySize * subjectSize * sizeof(int));
+	int *scoreMatrix = malloc((long)querySize * subjectSize * sizeof(int));
+	int *tbMatrix = malloc((long)querySize * subjectSize * sizeof(int));
 
 	//initialize variables
 	long int finalScore = 0;
-	//temporary allocation of string
-	char* queryResultReverse = malloc(querySize*2);
-	char* subjectResultReverse = malloc(subjectSize*2);
+	int numDiag = querySize + subjectSize - 3;
+	//alignment strings are filled from the back, both sequences plus the terminator at most
+	char* queryResult = malloc(querySize + subjectSize);
+	char* subjectResult = malloc(querySize + subjectSize);
+	if (!scoreMatrix || !tbMatrix || !queryResult || !subjectResult) {
+		printf("Unable to allocate matrices for %d x %d, %.1f MB needed\n", querySize - 1, subjectSize - 1,
+			2.0 * querySize * subjectSize * sizeof(int) / (1024 * 1024));
+		return 1;
+	}
 	//initialize matrix first row and column
-	initialize(scoreMatrix);
+	initialize(scoreMatrix, tbMatrix);
 
 	double initialTime = omp_get_wtime();
 
-	for (int i=1; i<querySize; i++) {
-		for (int j=1; j<subjectSize; j++) {
-			similarityScore(i, j, scoreMatrix, tbMatrix);
-		}
-	}
+	//the same kernel as NW_Omp, the whole of every anti-diagonal on one thread
+	for (int i=1; i <= numDiag; i++)
+		fillChunk(i, 0, 1, scoreMatrix, tbMatrix, NULL, NULL);
 
-	backtrack(tbMatrix, scoreMatrix, &finalScore, queryResultReverse, subjectResultReverse);
+	int resultStart = backtrack(tbMatrix, scoreMatrix, (long)querySize * subjectSize - 1, &finalScore, queryResult, subjectResult);
 	double finalTime = omp_get_wtime();
 	double timeElapsed = finalTime-initialTime;
-	printResults(finalScore, timeElapsed, queryResultReverse, subjectResultReverse);
+	printResults(finalScore, timeElapsed, 0, queryResult + resultStart, subjectResult + resultStart);
 	//printMatrix(scoreMatrix);
 	//printTracebackMatrix(tbMatrix);
 
 }
-
-void similarityScore(int i, int j, int* scoreMatrix, int* tbMatrix) {
-    int up, left, diag;
-
-    int index = querySize * i + j;
-
-    //Get element above
-    up = scoreMatrix[index-querySize] + gapScore;
-
-    //Get element on the left
-    left = scoreMatrix[index-1] + gapScore;
-
-    //Get element on the diagonal
-    diag = scoreMatrix[index-querySize-1] + matchMismatchScore(i, j);
-
-    //Calculates the maximum
-    int max;
-    int pred;
-    if (diag > left) {
-    	max = diag;
-    	pred = DIAG;
-    }
-    else {
-    	max = left;
-    	pred = LEFT;
-    }
-    if (up > max) {
-    	max = up;
-    	pred = UP;
-    }
-    //Inserts the value in the similarity and traceback matrixes
-    scoreMatrix[index] = max;
-    tbMatrix[index] = pred;
-}
-
-void backtrack(int* tbMatrix, int* scoreMatrix, long int* finalScore, char* queryResultReverse, char* subjectResultReverse) {
-    int predPos;
-	int resultSize = 0;
-	//start from bottom right corner
-	int currPos = querySize*subjectSize-1;
-    *finalScore = scoreMatrix[currPos];
-    //backtrack from btm right corner to top left corner
-    do {
-        if (tbMatrix[currPos] == DIAG) { //diagonal
-            predPos = currPos - querySize - 1;
-            //record character
-            queryResultReverse[resultSize] = query[(currPos%querySize)-1];
-            subjectResultReverse[resultSize++] = subject[((currPos-1)/querySize)-1];
-        }
-        else if (tbMatrix[currPos] == UP) { //up
-            predPos = currPos - querySize;
-            //insert - at subject string
-            queryResultReverse[resultSize] = '-';
-            subjectResultReverse[resultSize++] = subject[((currPos-1)/querySize)-1];
-        }
-        else if (tbMatrix[currPos] == LEFT) { //left
-            predPos = currPos - 1;
-            //insert - at query string
-            queryResultReverse[resultSize] = query[(currPos%querySize)-1];
-            subjectResultReverse[resultSize++] = '-';
-        }
-        tbMatrix[currPos] *= PATH;
-        currPos = predPos;
-
-    } while (currPos > 0);
-    //null terminating the strings
-    queryResultReverse[resultSize] = '\0';
-    subjectResultReverse[resultSize] = '\0';
-}
-
-void initialize(int* scoreMatrix) {
-	int i,j;
-
-	for (i=0; i<querySize; i++) {
-		for (j=0; j<subjectSize; j++) {
-			int index = querySize * i + j;
-			if (i==0 && j==0) {
-				scoreMatrix[index] = 0;
-			}
-			else if (i==0) {
-				scoreMatrix[index] = scoreMatrix[index-1] + gapScore;
-			}
-			else if (j==0) {
-				scoreMatrix[index] = scoreMatrix[index-querySize] + gapScore;
-			}
-			else {
-				scoreMatrix[index] = 0;
-			}
-		}
-	}
-}
-
-void printMatrix(int* matrix) {
-    int i, j;
-	printf("\nSimilarity Matrix:\n");
-    for (i = 0; i < querySize; i++) { //Lines
-        for (j = 0; j < subjectSize; j++) {
-            printf("%d\t", matrix[subjectSize * i +j ]);
-        }
-        printf("\n");
-    }
-}
-
-void printTracebackMatrix(int* matrix) {
-    int i, j, index;
-    for (i = 0; i < querySize; i++) { //Lines
-        for (j = 0; j < subjectSize; j++) {
-            index = querySize * i + j;
-            if(matrix[index] < 0) {
-                if (matrix[index] == -UP)
-                    printf("U ");
-                else if (matrix[index] == -LEFT)
-                    printf("L ");
-                else if (matrix[index] == -DIAG)
-                    printf("D ");
-                else
-                	printf("- ");
-            }
-            else {
-            	printf("- ");
-            }
-        }
-        printf("\n");
-    }
-}
-
-void printResults(long int finalScore, double time, char* qrr, char* srr) {
-	//reverse both strings
-	strrev(qrr);
-	strrev(srr);
-	printf("\n======================================\n");
-	printf("PROGRAM FINISHED\n");
-	printf("Analyzed query and subject string of %d\n", querySize-1);
-	printf("1) FINAL SCORE: %ld\n", finalScore);
-	printf("2) ALIGNMENT STRING SIZE: %d\n", strlen(qrr));
-	printf("3) ALIGNMENT STRING:\n");
-	printf("\t%s\n", qrr);
-	printf("\t");
-	for (int i=0; i<strlen(qrr); i++) {
-		if ((qrr[i] == '-') | (srr[i] == '-')) {
-			printf(" ");
-		}
-		else if (qrr[i] == srr[i]) {
-			printf("|");
-		}
-		else {
-			printf("*");
-		}
-	}
-	printf("\n\t%s\n", srr);
-	printf("4) TIME ELAPSED: %fs\n", time);
-  	printf("======================================\n");
-}
-
-int matchMismatchScore(int i, int j) {
-	if (subject[i-1] == query[j-1])
-        return matchScore;
-    else
-        return mismatchScore;
-}
-
-int max(int x, int y) {
-	if (x > y)
-		return x;
-	else
-		return y;
-}
-
-void readFiles(char* queryFile, char* subjectFile) {
-	FILE* qfp = fopen(queryFile, "r");
-	FILE* sfp = fopen(subjectFile, "r");
-
-	if (qfp) {
-		fseek(qfp, 0, SEEK_END);
-		querySize = ftell(qfp);
-		fseek(qfp, 0, SEEK_SET);
-		query = malloc(querySize);
-		if (query) {
-			fread(query, 1, querySize, qfp);
-		}
-		fclose(qfp);
-	}
-
-	if (sfp) {
-		fseek(sfp, 0, SEEK_END);
-		subjectSize = ftell(sfp);
-		fseek(sfp, 0, SEEK_SET);
-		subject = malloc(subjectSize);
-		if (subject) {
-			fread(subject, 1, subjectSize, sfp);
-		}
-		fclose(sfp);
-	}
-}
-
@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//Define output formats
+#define TEXT 0
+#define PAF 1
+#define JSON 2
+
+#include "../Common/Fasta.h"
+
+typedef struct {
+	int subject;   //index into the database
+	long int score;
+	int queryStart, queryEnd, subjectStart, subjectEnd;   //0 based, half open
+	int length, matches, editDistance;
+	char* cigar;
+} Hit;
+
+//Bounded min-heap of the best hits of one query, the root is the worst hit kept
+typedef struct {
+	Hit* hits;
+	int size;
+	int capacity;
+} HitHeap;
+
+static inline int swCell(int diag, int left, int up, int* pred);
+long int scoreOnly(Record* query, Record* subject, int* row);
+int hitBetter(Hit* a, Hit* b);
+void heapInsert(HitHeap* heap, int subject, long int score);
+void siftDown(HitHeap* heap, int k);
+int compareHits(const void* a, const void* b);
+void tracebackHit(Record* query, Record* subject, Hit* hit);
+int prependCigarOp(char* cigar, int start, char op, int length);
+void printHits(Record* query, Record* database, HitHeap* heap);
+void writePaf(Record* query, Record* database, HitHeap* heap);
+void writeJson(Record* query, Record* database, HitHeap* heap);
+char* baseName(char* path);
+int max(int x, int y);
+int min(int x, int y);
+
+//Default scores, can be overridden from the command line
+int matchScore = 2;
+int mismatchScore = -2;
+int gapScore = -5;
+//Hits kept per query and the smallest score reported
+int maxHits = 10;
+long int minScore = 1;
+int outputFormat = TEXT;
+const char* formatNames[] = {"text", "paf", "json"};
+
+int main(int argc, char* argv[]) {
+	if (argc < 4) {
+		printf("Please enter in this format: SmithW_Search <query_file_name> <database_fasta> <num_threads> [-n max_hits] [-t min_score] [-s match mismatch gap] [-f text|paf|json]\n");
+		return 1;
+	}
+	char* queryFile = argv[1];
+	char* databaseFile = argv[2];
+	int thread_count = atoi(argv[3]);
+	for (int a = 4; a < argc; a++) {
+		if (strcmp(argv[a], "-n") == 0 && a + 1 < argc)
+			maxHits = atoi(argv[++a]);
+		else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc)
+			minScore = atol(argv[++a]);
+		else if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+			matchScore = atoi(argv[++a]);
+			mismatchScore = atoi(argv[++a]);
+			gapScore = atoi(argv[++a]);
+		}
+		else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			for (outputFormat = JSON; outputFormat > TEXT; outputFormat--) {
+				if (strcmp(argv[a + 1], formatNames[outputFormat]) == 0)
+					break;
+			}
+			a++;
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	if (maxHits < 1)
+		maxHits = 1;
+	if (minScore < 1)
+		minScore = 1;
+	Record* queries, * database;
+	int numQueries = readFasta(queryFile, &queries);
+	int numSubjects = readFasta(databaseFile, &database);
+	if (numQueries < 0 || numSubjects < 0) {
+		printf("Unable to read %s or %s\n", queryFile, databaseFile);
+		return 1;
+	}
+	long int databaseSize = 0;
+	int longestQuery = 0;
+	for (int s = 0; s < numSubjects; s++)
+		databaseSize += database[s].length;
+	for (int q = 0; q < numQueries; q++)
+		longestQuery = max(longestQuery, queries[q].length);
+	//hits are written in few large blocks
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	HitHeap* heaps = malloc(numQueries * sizeof(HitHeap));
+	if (!heaps) {
+		printf("Unable to allocate the hits of %d queries\n", numQueries);
+		return 1;
+	}
+	long int scored = 0, skipped = 0, tracebacks = 0, cells = 0;
+	int numThreads = 0;
+	int failed = 0;
+
+	double initialTime = omp_get_wtime();
+
+	for (int q = 0; q < numQueries; q++) {
+		Record* query = &queries[q];
+		HitHeap* heap = &heaps[q];
+		heap->hits = malloc(maxHits * sizeof(Hit));
+		if (!heap->hits) {
+			printf("Unable to allocate %d hits for %s\n", maxHits, query->name);
+			return 1;
+		}
+		heap->size = 0;
+		heap->capacity = maxHits;
+		//smallest score that can still enter the heap, raised once it is full
+		long int cutoff = minScore;
+
+		#pragma omp parallel num_threads(thread_count) \
+		default(none) shared(query, heap, cutoff, database, numSubjects, longestQuery, matchScore, numThreads, failed) \
+		reduction(+:scored, skipped, cells)
+		{
+			//one score row per thread, reused for every subject
+			int* row = malloc((longestQuery + 1) * sizeof(int));
+			if (!row) {
+				#pragma omp atomic write
+				failed = 1;
+			}
+			numThreads = omp_get_num_threads();
+			#pragma omp for schedule(dynamic, 16)
+			for (int s = 0; s < numSubjects; s++) {
+				//a thread without a row still takes part in the loop but skips its share
+				if (!row)
+					continue;
+				long int current;
+				#pragma omp atomic read
+				current = cutoff;
+				//a local alignment cannot score more than all matches over the shorter sequence
+				long int bound = (long int)matchScore * min(query->length, database[s].length);
+				if (bound < current) {
+					skipped++;
+					continue;
+				}
+				long int score = scoreOnly(query, &database[s], row);
+				scored++;
+				cells += (long int)query->length * database[s].length;
+				if (score < current)
+					continue;
+				#pragma omp critical
+				{
+					heapInsert(heap, s, score);
+					if (heap->size == heap->capacity && heap->hits[0].score > cutoff) {
+						#pragma omp atomic write
+						cutoff = heap->hits[0].score;
+					}
+				}
+			}
+			free(row);
+		}
+		if (failed) {
+			printf("Unable to allocate the score rows for %s\n", query->name);
+			return 1;
+		}
+
+		//only the surviving hits get a traceback matrix
+		qsort(heap->hits, heap->size, sizeof(Hit), compareHits);
+		#pragma omp parallel for num_threads(thread_count) schedule(dynamic, 1)
+		for (int h = 0; h < heap->size; h++)
+			tracebackHit(query, &database[heap->hits[h].subject], &heap->hits[h]);
+		tracebacks += heap->size;
+	}
+
+	double finalTime = omp_get_wtime();
+	double timeElapsed = finalTime - initialTime;
+
+	if (outputFormat == TEXT) {
+		printf("\n======================================\n");
+		printf("PROGRAM FINISHED\n");
+		printf("Searched %d queries against %d subjects (%ld residues)\n", numQueries, numSubjects, databaseSize);
+		printf("1) SUBJECTS SCORED: %ld (%ld skipped by the score bound)\n", scored, skipped);
+		printf("2) TRACEBACKS COMPUTED: %ld\n", tracebacks);
+		printf("3) HITS:\n");
+		for (int q = 0; q < numQueries; q++)
+			printHits(&queries[q], database, &heaps[q]);
+		printf("4) TIME ELAPSED: %fs\n", timeElapsed);
+		printf("5) GCUPS (score only pass): %f\n", timeElapsed > 0 ? cells / timeElapsed / 1e9 : 0.0);
+		printf("6) NUMBER OF THREADS USED: %d\n", numThreads);
+		printf("======================================\n");
+	}
+	else {
+		for (int q = 0; q < numQueries; q++) {
+			if (outputFormat == PAF)
+				writePaf(&queries[q], database, &heaps[q]);
+			else
+				writeJson(&queries[q], database, &heaps[q]);
+		}
+	}
+	return 0;
+}
+
+//One Smith-Waterman cell from its diagonal, left and up candidates, gaps and the
+//pair score already added. Ties go to diag, then left, then up, a cell at 0 or below
+//starts over. The score only pass and the traceback both fill with it, so the two
+//cannot disagree on a score. PairKernel.h is not used here as it fixes the scores
+//at compile time and keeps a single pair in globals, while the search takes -s and
+//scores many pairs at once.
+static inline int swCell(int diag, int left, int up, int* pred) {
+	int max = diag;
+	*pred = DIAG;
+	if (left > max) {
+		max = left;
+		*pred = LEFT;
+	}
+	if (up > max) {
+		max = up;
+		*pred = UP;
+	}
+	if (max <= 0) {
+		max = 0;
+		*pred = NONE;
+	}
+	return max;
+}
+
+//Best local score of the pair with a single row over the query, no traceback
+long int scoreOnly(Record* query, Record* subject, int* row) {
+	int best = 0;
+	int cols = query->length;
+	for (int j = 0; j <= cols; j++)
+		row[j] = 0;
+	for (int i = 0; i < subject->length; i++) {
+		char s = subject->seq[i];
+		int diag = 0;
+		int left = 0;
+		for (int j = 1; j <= cols; j++) {
+			int up = row[j];
+			int pred;
+			int score = swCell(diag + (query->seq[j-1] == s ? matchScore : mismatchScore), left + gapScore, up + gapScore, &pred);
+			if (score > best)
+				best = score;
+			diag = up;
+			left = score;
+			row[j] = score;
+		}
+	}
+	return best;
+}
+
+//Higher score wins, equal scores go to the earlier subject so the report does not
+//depend on which thread finished first
+int hitBetter(Hit* a, Hit* b) {
+	if (a->score != b->score)
+		return a->score > b->score;
+	return a->subject < b->subject;
+}
+
+void heapInsert(HitHeap* heap, int subject, long int score) {
+	Hit hit;
+	memset(&hit, 0, sizeof(Hit));
+	hit.subject = subject;
+	hit.score = score;
+	if (heap->size < heap->capacity) {
+		//sift the new hit up from the last leaf
+		int k = heap->size++;
+		while (k > 0 && hitBetter(&heap->hits[(k - 1) / 2], &hit)) {
+			heap->hits[k] = heap->hits[(k - 1) / 2];
+			k = (k - 1) / 2;
+		}
+		heap->hits[k] = hit;
+	}
+	else if (hitBetter(&hit, &heap->hits[0])) {
+		heap->hits[0] = hit;
+		siftDown(heap, 0);
+	}
+}
+
+void siftDown(HitHeap* heap, int k) {
+	Hit hit = heap->hits[k];
+	for (;;) {
+		int child = 2 * k + 1;
+		if (child >= heap->size)
+			break;
+		if (child + 1 < heap->size && hitBetter(&heap->hits[child], &heap->hits[child + 1]))
+			child++;
+		if (!hitBetter(&hit, &heap->hits[child]))
+			break;
+		heap->hits[k] = heap->hits[child];
+		k = child;
+	}
+	heap->hits[k] = hit;
+}
+
+int compareHits(const void* a, const void* b) {
+	Hit* x = (Hit*)a;
+	Hit* y = (Hit*)b;
+	if (hitBetter(x, y))
+		return -1;
+	return hitBetter(y, x);
+}
+
+//Full matrix Smith-Waterman of one surviving pair, rows are the query and columns
+//the subject. Ties go to the first cell in row major order like Align_Omp local.
+void tracebackHit(Record* query, Record* subject, Hit* hit) {
+	int rows = query->length + 1;
+	int cols = subject->length + 1;
+	char* tbMatrix = malloc((long)rows * cols);
+	int* prevRow = calloc(cols, sizeof(int));
+	int* currRow = calloc(cols, sizeof(int));
+	if (!tbMatrix || !prevRow || !currRow) {
+		fprintf(stderr, "Unable to allocate the traceback of %s against %s\n", query->name, subject->name);
+		exit(1);
+	}
+	memset(tbMatrix, NONE, cols);
+	int bestScore = 0;
+	long bestPos = 0;
+	for (int i = 1; i < rows; i++) {
+		long rowIndex = (long)cols * i;
+		tbMatrix[rowIndex] = NONE;
+		char q = query->seq[i-1];
+		for (int j = 1; j < cols; j++) {
+			int pred;
+			int max = swCell(prevRow[j-1] + (q == subject->seq[j-1] ? matchScore : mismatchScore),
+				currRow[j-1] + gapScore, prevRow[j] + gapScore, &pred);
+			currRow[j] = max;
+			tbMatrix[rowIndex + j] = pred;
+			if (max > bestScore) {
+				bestScore = max;
+				bestPos = rowIndex + j;
+			}
+		}
+		int* temp = prevRow;
+		prevRow = currRow;
+		currRow = temp;
+	}
+
+	//the CIGAR is written from the back so it comes out in reading order
+	int cigarStart = 2 * (rows + cols);
+	char* cigarBuffer = malloc(cigarStart + 1);
+	if (!cigarBuffer) {
+		fprintf(stderr, "Unable to allocate the CIGAR of %s against %s\n", query->name, subject->name);
+		exit(1);
+	}
+	cigarBuffer[cigarStart] = '\0';
+	char runOp = 0;
+	int runLength = 0;
+	hit->length = 0;
+	hit->matches = 0;
+	hit->editDistance = 0;
+	long currPos = bestPos;
+	while (tbMatrix[currPos] != NONE) {
+		int i = currPos / cols;
+		int j = currPos % cols;
+		char op;
+		if (tbMatrix[currPos] == DIAG) {
+			op = 'M';
+			if (query->seq[i-1] == subject->seq[j-1])
+				hit->matches++;
+			else
+				hit->editDistance++;
+			currPos -= cols + 1;
+		}
+		else if (tbMatrix[currPos] == UP) {
+			op = 'I';
+			hit->editDistance++;
+			currPos -= cols;
+		}
+		else {
+			op = 'D';
+			hit->editDistance++;
+			currPos -= 1;
+		}
+		if (op != runOp) {
+			cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+			runOp = op;
+			runLength = 0;
+		}
+		runLength++;
+		hit->length++;
+	}
+	cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+	hit->queryStart = currPos / cols;
+	hit->subjectStart = currPos % cols;
+	hit->queryEnd = bestPos / cols;
+	hit->subjectEnd = bestPos % cols;
+	hit->cigar = strdup(cigarBuffer + cigarStart);
+	if (!hit->cigar) {
+		fprintf(stderr, "Unable to allocate the CIGAR of %s against %s\n", query->name, subject->name);
+		exit(1);
+	}
+
+	free(cigarBuffer);
+	free(tbMatrix);
+	free(prevRow);
+	free(currRow);
+}
+
+int prependCigarOp(char* cigar, int start, char op, int length) {
+	if (length == 0)
+		return start;
+	cigar[--start] = op;
+	do {
+		cigar[--start] = '0' + length % 10;
+		length /= 10;
+	} while (length > 0);
+	return start;
+}
+
+void printHits(Record* query, Record* database, HitHeap* heap) {
+	printf("\t%s (%d): %d hits\n", query->name, query->length, heap->size);
+	for (int h = 0; h < heap->size; h++) {
+		Hit* hit = &heap->hits[h];
+		printf("\t\t%d. %s score %ld query %d-%d subject %d-%d CIGAR %s\n", h + 1, database[hit->subject].name,
+			hit->score, hit->queryStart, hit->queryEnd, hit->subjectStart, hit->subjectEnd, hit->cigar);
+	}
+}
+
+void writePaf(Record* query, Record* database, HitHeap* heap) {
+	for (int h = 0; h < heap->size; h++) {
+		Hit* hit = &heap->hits[h];
+		printf("%s\t%d\t%d\t%d\t+\t%s\t%d\t%d\t%d\t%d\t%d\t255\tAS:i:%ld\tNM:i:%d\tcg:Z:%s\n",
+			query->name, query->length, hit->queryStart, hit->queryEnd,
+			database[hit->subject].name, database[hit->subject].length, hit->subjectStart, hit->subjectEnd,
+			hit->matches, hit->length, hit->score, hit->editDistance, hit->cigar);
+	}
+}
+
+void writeJson(Record* query, Record* database, HitHeap* heap) {
+	//one object per line so batches can be streamed
+	for (int h = 0; h < heap->size; h++) {
+		Hit* hit = &heap->hits[h];
+		printf("{\"query\":\"%s\",\"subject\":\"%s\",\"rank\":%d,\"score\":%ld,"
+			"\"query_start\":%d,\"query_end\":%d,\"subject_start\":%d,\"subject_end\":%d,"
+			"\"length\":%d,\"matches\":%d,\"edit_distance\":%d,\"cigar\":\"%s\"}\n",
+			query->name, database[hit->subject].name, h + 1, hit->score,
+			hit->queryStart, hit->queryEnd, hit->subjectStart, hit->subjectEnd,
+			hit->length, hit->matches, hit->editDistance, hit->cigar);
+	}
+}
+
+char* baseName(char* path) {
+	char* slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+int max(int x, int y) {
+	if (x > y)
+		return x;
+	else
+		return y;
+}
+
+int min(int x, int y) {
+	if (x > y)
+		return y;
+	else
+		return x;
+}
@@ -0,0 +1,681 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+//Define direction constants
+#define NONE 0
+#define UP 1
+#define LEFT 2
+#define DIAG 3
+//Define extension modes
+#define GLOCAL 0
+#define LOCAL 1
+//k-mers seen more often than this in the subject are repeats and not used as seeds
+#define maxOccurrences 64
+//Largest k that fits 2 bits per base in an unsigned int
+#define maxKmerSize 16
+//open chains of a diagonal band a seed is tried against, the most recent first
+#define maxOpenChains 64
+//Define output formats
+#define TEXT 0
+#define SAM 1
+#define PAF 2
+#define JSON 3
+
+typedef struct {
+	unsigned int kmer;
+	int pos;
+} IndexEntry;
+
+typedef struct {
+	int diagonal;   //subject position - query position
+	int queryPos;
+} Seed;
+
+typedef struct {
+	int numSeeds;
+	int minDiagonal, maxDiagonal;
+	int lastQueryPos, lastSubjectPos;   //last seed, the next one must be past it in both
+} Chain;
+
+typedef struct {
+	int numSeeds;
+	int windowStart, windowEnd;   //subject window handed to the DP, half open
+	long int score;
+	int queryStart, queryEnd, subjectStart, subjectEnd;   //0 based, half open
+	int length, matches, editDistance;
+	char* cigar;   //M, I (query base against a gap) and D (subject base against a gap)
+} Hit;
+
+void readFiles(char* queryFile, char* subjectFile);
+int encodeBase(char c);
+int buildIndex(void);
+int findSeeds(Seed** seeds);
+int chainSeeds(Seed* seeds, int numSeeds, Hit** hits);
+int extendHit(Hit* hit);
+int compareSeeds(const void* a, const void* b);
+int compareQueryPos(const void* a, const void* b);
+int compareChains(const void* a, const void* b);
+int compareScores(const void* a, const void* b);
+int prependCigarOp(char* cigar, int start, char op, int length);
+void printResults(Hit* hits, int numHits, int numSeeds, double indexTime, double time, int numThreads);
+void writeSam(Hit* hits, int numHits);
+void writePaf(Hit* hits, int numHits);
+void writeJson(Hit* hits, int numHits);
+char* baseName(char* path);
+int max(int x, int y);
+int min(int x, int y);
+
+//Default scores, can be overridden from the command line
+int matchScore = 2;
+int mismatchScore = -2;
+int gapScore = -5;
+//Default seeding parameters
+int kmerSize = 15;
+int minSeeds = 3;
+int maxHits = 10;
+int bandGap = 64;      //largest diagonal shift allowed between seeds of one chain
+int windowPad = 100;   //subject bases added either side of a chain before extension
+int mode = GLOCAL;
+int outputFormat = TEXT;
+const char* formatNames[] = {"text", "sam", "paf", "json"};
+
+int querySize = 0;
+int subjectSize = 0;
+char* query, * subject;
+char* queryName, * subjectName;
+
+//k-mer index over the subject, entries grouped by hash bucket
+int indexBits = 0;
+int* bucketStart;
+IndexEntry* indexEntries;
+
+int main(int argc, char* argv[]) {
+	if (argc < 4) {
+		printf("Please enter in this format: SeedExtend <query_file_name> <subject_file_name> <num_threads> [-k kmer_size] [-m min_seeds] [-n max_hits] [-p window_pad] [-l] [-s match mismatch gap] [-f text|sam|paf|json]\n");
+		return 1;
+	}
+	char* queryFile = argv[1];
+	char* subjectFile = argv[2];
+	int thread_count = atoi(argv[3]);
+	for (int a = 4; a < argc; a++) {
+		if (strcmp(argv[a], "-k") == 0 && a + 1 < argc)
+			kmerSize = atoi(argv[++a]);
+		else if (strcmp(argv[a], "-m") == 0 && a + 1 < argc)
+			minSeeds = atoi(argv[++a]);
+		else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc)
+			maxHits = atoi(argv[++a]);
+		else if (strcmp(argv[a], "-p") == 0 && a + 1 < argc)
+			windowPad = atoi(argv[++a]);
+		else if (strcmp(argv[a], "-l") == 0)
+			mode = LOCAL;
+		else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+			for (outputFormat = JSON; outputFormat > TEXT; outputFormat--) {
+				if (strcmp(argv[a + 1], formatNames[outputFormat]) == 0)
+					break;
+			}
+			a++;
+		}
+		else if (strcmp(argv[a], "-s") == 0 && a + 3 < argc) {
+			matchScore = atoi(argv[++a]);
+			mismatchScore = atoi(argv[++a]);
+			gapScore = atoi(argv[++a]);
+		}
+		else {
+			printf("Unknown option: %s\n", argv[a]);
+			return 1;
+		}
+	}
+	if (kmerSize < 1 || kmerSize > maxKmerSize) {
+		printf("k-mer size must be between 1 and %d\n", maxKmerSize);
+		return 1;
+	}
+	readFiles(queryFile, subjectFile);
+	queryName = baseName(queryFile);
+	subjectName = baseName(subjectFile);
+	omp_set_num_threads(thread_count);
+	//hits are written in few large blocks
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+	double initialTime = omp_get_wtime();
+	if (!buildIndex()) {
+		printf("Unable to allocate the k-mer index for a subject of %d\n", subjectSize);
+		return 1;
+	}
+	double indexTime = omp_get_wtime() - initialTime;
+
+	Seed* seeds;
+	Hit* hits;
+	int numSeeds = findSeeds(&seeds);
+	int numHits = numSeeds < 0 ? -1 : chainSeeds(seeds, numSeeds, &hits);
+	if (numHits < 0) {
+		printf("Unable to allocate the seeds of a query of %d\n", querySize);
+		return 1;
+	}
+
+	//each candidate window is an independent alignment
+	int numThreads = 0;
+	int failed = 0;
+	#pragma omp parallel
+	{
+		#pragma omp single
+		numThreads = omp_get_num_threads();
+		#pragma omp for schedule(dynamic)
+		for (int h = 0; h < numHits; h++) {
+			if (!extendHit(&hits[h])) {
+				#pragma omp atomic write
+				failed = 1;
+			}
+		}
+	}
+	if (failed) {
+		printf("Unable to allocate the extension matrices for a query of %d\n", querySize);
+		return 1;
+	}
+	qsort(hits, numHits, sizeof(Hit), compareScores);
+
+	double finalTime = omp_get_wtime();
+	if (outputFormat == SAM)
+		writeSam(hits, numHits);
+	else if (outputFormat == PAF)
+		writePaf(hits, numHits);
+	else if (outputFormat == JSON)
+		writeJson(hits, numHits);
+	else
+		printResults(hits, numHits, numSeeds, indexTime, finalTime - initialTime, numThreads);
+	return 0;
+}
+
+int encodeBase(char c) {
+	switch (c) {
+		case 'a': case 'A': return 0;
+		case 'c': case 'C': return 1;
+		case 'g': case 'G': return 2;
+		case 't': case 'T': return 3;
+		default: return -1;
+	}
+}
+
+static inline unsigned int hashKmer(unsigned int kmer) {
+	return (kmer * 2654435761u) >> (32 - indexBits);
+}
+
+//Returns 0 when out of memory
+int buildIndex(void) {
+	//about one bucket per subject position
+	indexBits = 1;
+	while ((1 << indexBits) < subjectSize && indexBits < 30)
+		indexBits++;
+	int numBuckets = 1 << indexBits;
+	unsigned int mask = kmerSize == maxKmerSize ? 0xffffffffu : (1u << (2 * kmerSize)) - 1;
+	bucketStart = calloc(numBuckets + 1, sizeof(int));
+	indexEntries = malloc(max(subjectSize, 1) * sizeof(IndexEntry));
+	if (!bucketStart || !indexEntries)
+		return 0;
+
+	//first pass counts entries per bucket, second pass places them
+	for (int pass = 0; pass < 2; pass++) {
+		unsigned int kmer = 0;
+		int valid = 0;
+		for (int j = 0; j < subjectSize; j++) {
+			int code = encodeBase(subject[j]);
+			if (code < 0) {
+				valid = 0;
+				continue;
+			}
+			kmer = ((kmer << 2) | code) & mask;
+			if (++valid < kmerSize)
+				continue;
+			unsigned int bucket = hashKmer(kmer);
+			if (pass == 0) {
+				bucketStart[bucket + 1]++;
+			}
+			else {
+				IndexEntry entry = {kmer, j - kmerSize + 1};
+				indexEntries[bucketStart[bucket]++] = entry;
+			}
+		}
+		if (pass == 0) {
+			for (int b = 0; b < numBuckets; b++)
+				bucketStart[b + 1] += bucketStart[b];
+		}
+		else {
+			//placing advanced every start to the next bucket, shift them back
+			for (int b = numBuckets; b > 0; b--)
+				bucketStart[b] = bucketStart[b - 1];
+			bucketStart[0] = 0;
+		}
+	}
+	return 1;
+}
+
+//Returns the number of seeds, -1 when out of memory
+int findSeeds(Seed** seeds) {
+	unsigned int mask = kmerSize == maxKmerSize ? 0xffffffffu : (1u << (2 * kmerSize)) - 1;
+	int capacity = 1024;
+	int numSeeds = 0;
+	*seeds = malloc(capacity * sizeof(Seed));
+	if (!*seeds)
+		return -1;
+
+	unsigned int kmer = 0;
+	int valid = 0;
+	for (int i = 0; i < querySize; i++) {
+		int code = encodeBase(query[i]);
+		if (code < 0) {
+			valid = 0;
+			continue;
+		}
+		kmer = ((kmer << 2) | code) & mask;
+		if (++valid < kmerSize)
+			continue;
+		unsigned int bucket = hashKmer(kmer);
+		int occurrences = 0;
+		for (int e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++) {
+			if (indexEntries[e].kmer == kmer)
+				occurrences++;
+		}
+		if (occurrences == 0 || occurrences > maxOccurrences)
+			continue;
+		for (int e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++) {
+			if (indexEntries[e].kmer != kmer)
+				continue;
+			if (numSeeds == capacity) {
+				Seed* grown = realloc(*seeds, 2 * capacity * sizeof(Seed));
+				if (!grown)
+					return -1;
+				*seeds = grown;
+				capacity *= 2;
+			}
+			Seed seed = {indexEntries[e].pos - (i - kmerSize + 1), i - kmerSize + 1};
+			(*seeds)[numSeeds++] = seed;
+		}
+	}
+	return numSeeds;
+}
+
+//Seeds on nearby diagonals are grouped into bands, allowing for small indels, and
+//every band is chained in query order. A seed joins a chain only when it comes
+//after the last seed of the chain in both the query and the subject, and when the
+//diagonals of the chain stay within bandGap, so the window of a chain is never
+//wider than querySize + 2 * windowPad + bandGap. Seeds that fit no open chain
+//start a new one. Returns the number of hits, -1 when out of memory.
+int chainSeeds(Seed* seeds, int numSeeds, Hit** hits) {
+	qsort(seeds, numSeeds, sizeof(Seed), compareSeeds);
+	int numHits = 0;
+	*hits = malloc(max(numSeeds, 1) * sizeof(Hit));
+	Chain* chains = malloc(max(numSeeds, 1) * sizeof(Chain));
+	if (!*hits || !chains) {
+		free(chains);
+		return -1;
+	}
+	int first = 0;
+	for (int s = 1; s <= numSeeds; s++) {
+		if (s < numSeeds && seeds[s].diagonal - seeds[s - 1].diagonal <= bandGap)
+			continue;
+		//seeds first to s - 1 are one band, now in query order
+		qsort(seeds + first, s - first, sizeof(Seed), compareQueryPos);
+		int numChains = 0;
+		for (int t = first; t < s; t++) {
+			int diagonal = seeds[t].diagonal;
+			int queryPos = seeds[t].queryPos;
+			int subjectPos = diagonal + queryPos;
+			Chain* chain = NULL;
+			for (int c = numChains - 1; c >= max(numChains - maxOpenChains, 0) && !chain; c--) {
+				if (queryPos > chains[c].lastQueryPos && subjectPos > chains[c].lastSubjectPos
+					&& max(chains[c].maxDiagonal, diagonal) - min(chains[c].minDiagonal, diagonal) <= bandGap)
+					chain = &chains[c];
+			}
+			if (!chain) {
+				chain = &chains[numChains++];
+				chain->numSeeds = 0;
+				chain->minDiagonal = chain->maxDiagonal = diagonal;
+			}
+			chain->numSeeds++;
+			chain->minDiagonal = min(chain->minDiagonal, diagonal);
+			chain->maxDiagonal = max(chain->maxDiagonal, diagonal);
+			chain->lastQueryPos = queryPos;
+			chain->lastSubjectPos = subjectPos;
+		}
+		for (int c = 0; c < numChains; c++) {
+			if (chains[c].numSeeds < minSeeds)
+				continue;
+			Hit* hit = &(*hits)[numHits++];
+			memset(hit, 0, sizeof(Hit));
+			hit->numSeeds = chains[c].numSeeds;
+			hit->windowStart = max(chains[c].minDiagonal - windowPad, 0);
+			hit->windowEnd = min(chains[c].maxDiagonal + querySize + windowPad, subjectSize);
+		}
+		first = s;
+	}
+	free(chains);
+	//only the best supported chains are extended
+	qsort(*hits, numHits, sizeof(Hit), compareChains);
+	return min(numHits, maxHits);
+}
+
+//Aligns the whole query against the subject window of a hit, glocal unless -l was
+//given. Scores are kept in two rows, only the traceback needs the full matrix.
+//Returns 0 when out of memory.
+int extendHit(Hit* hit) {
+	const char* window = subject + hit->windowStart;
+	int rows = querySize + 1;
+	int cols = hit->windowEnd - hit->windowStart + 1;
+	int* prevRow = malloc(cols * sizeof(int));
+	int* currRow = malloc(cols * sizeof(int));
+	char* tbMatrix = malloc((long)rows * cols);
+	if (!prevRow || !currRow || !tbMatrix) {
+		free(prevRow);
+		free(currRow);
+		free(tbMatrix);
+		return 0;
+	}
+	long int bestScore = mode == LOCAL ? 0 : -2147483647L;
+	long bestPos = 0;
+
+	//the subject start is always free, the query start only in local mode
+	for (int j = 0; j < cols; j++) {
+		prevRow[j] = 0;
+		tbMatrix[j] = NONE;
+	}
+	for (int i = 1; i < rows; i++) {
+		long rowIndex = (long)cols * i;
+		currRow[0] = mode == LOCAL ? 0 : i * gapScore;
+		tbMatrix[rowIndex] = mode == LOCAL ? NONE : UP;
+		for (int j = 1; j < cols; j++) {
+			int up = prevRow[j] + gapScore;
+			int left = currRow[j-1] + gapScore;
+			int diag = prevRow[j-1] + (query[i-1] == window[j-1] ? matchScore : mismatchScore);
+			int max = diag;
+			char pred = DIAG;
+			if (left > max) {
+				max = left;
+				pred = LEFT;
+			}
+			if (up > max) {
+				max = up;
+				pred = UP;
+			}
+			if (mode == LOCAL && max <= 0) {
+				max = 0;
+				pred = NONE;
+			}
+			currRow[j] = max;
+			tbMatrix[rowIndex + j] = pred;
+			//local ends anywhere, glocal anywhere in the last row
+			if ((mode == LOCAL || i == rows - 1) && max > bestScore) {
+				bestScore = max;
+				bestPos = rowIndex + j;
+			}
+		}
+		int* temp = prevRow;
+		prevRow = currRow;
+		currRow = temp;
+	}
+
+	//the CIGAR is written from the back so it comes out in reading order
+	int cigarStart = 2 * (rows + cols);
+	char* cigarBuffer = malloc(cigarStart + 1);
+	if (!cigarBuffer) {
+		free(tbMatrix);
+		free(prevRow);
+		free(currRow);
+		return 0;
+	}
+	cigarBuffer[cigarStart] = '\0';
+	char runOp = 0;
+	int runLength = 0;
+	hit->length = 0;
+	hit->matches = 0;
+	hit->editDistance = 0;
+	long currPos = bestPos;
+	while (tbMatrix[currPos] != NONE) {
+		int i = currPos / cols;
+		int j = currPos % cols;
+		char op;
+		if (tbMatrix[currPos] == DIAG) {
+			op = 'M';
+			if (query[i-1] == window[j-1])
+				hit->matches++;
+			else
+				hit->editDistance++;
+			currPos -= cols + 1;
+		}
+		else if (tbMatrix[currPos] == UP) {
+			op = 'I';
+			hit->editDistance++;
+			currPos -= cols;
+		}
+		else {
+			op = 'D';
+			hit->editDistance++;
+			currPos -= 1;
+		}
+		if (op != runOp) {
+			cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+			runOp = op;
+			runLength = 0;
+		}
+		runLength++;
+		hit->length++;
+	}
+	cigarStart = prependCigarOp(cigarBuffer, cigarStart, runOp, runLength);
+	hit->score = bestScore;
+	hit->queryStart = currPos / cols;
+	hit->queryEnd = bestPos / cols;
+	hit->subjectStart = hit->windowStart + currPos % cols;
+	hit->subjectEnd = hit->windowStart + bestPos % cols;
+	hit->cigar = strdup(cigarBuffer + cigarStart);
+
+	free(cigarBuffer);
+	free(tbMatrix);
+	free(prevRow);
+	free(currRow);
+	return hit->cigar != NULL;
+}
+
+int compareSeeds(const void* a, const void* b) {
+	const Seed* x = a;
+	const Seed* y = b;
+	if (x->diagonal != y->diagonal)
+		return x->diagonal < y->diagonal ? -1 : 1;
+	return x->queryPos - y->queryPos;
+}
+
+int compareQueryPos(const void* a, const void* b) {
+	const Seed* x = a;
+	const Seed* y = b;
+	if (x->queryPos != y->queryPos)
+		return x->queryPos - y->queryPos;
+	return x->diagonal - y->diagonal;
+}
+
+int compareChains(const void* a, const void* b) {
+	const Hit* x = a;
+	const Hit* y = b;
+	if (x->numSeeds != y->numSeeds)
+		return y->numSeeds - x->numSeeds;
+	return x->windowStart - y->windowStart;
+}
+
+int compareScores(const void* a, const void* b) {
+	const Hit* x = a;
+	const Hit* y = b;
+	if (x->score != y->score)
+		return x->score < y->score ? 1 : -1;
+	return x->subjectStart - y->subjectStart;
+}
+
+void printResults(Hit* hits, int numHits, int numSeeds, double indexTime, double time, int numThreads) {
+	printf("\n======================================\n");
+	printf("PROGRAM FINISHED\n");
+	printf("Analyzed query string of %d against subject string of %d\n", querySize, subjectSize);
+	printf("1) SEEDS FOUND: %d (k = %d)\n", numSeeds, kmerSize);
+	printf("2) CANDIDATE WINDOWS EXTENDED: %d\n", numHits);
+	printf("3) HITS:\n");
+	for (int h = 0; h < numHits; h++) {
+		printf("\tscore %ld seeds %d query %d-%d subject %d-%d\n", hits[h].score, hits[h].numSeeds,
+			hits[h].queryStart, hits[h].queryEnd, hits[h].subjectStart, hits[h].subjectEnd);
+	}
+	if (numHits > 0) {
+		//expand the CIGAR of the best hit into the two strings and the match bar
+		Hit* best = &hits[0];
+		int length = best->length;
+		char* qr = malloc(length + 1);
+		char* matchBar = malloc(length + 1);
+		char* sr = malloc(length + 1);
+		int i = best->queryStart;
+		int j = best->subjectStart;
+		int k = 0;
+		for (char* c = best->cigar; *c; ) {
+			int n = strtol(c, &c, 10);
+			char op = *c++;
+			while (n-- > 0) {
+				qr[k] = op == 'D' ? '-' : query[i++];
+				sr[k] = op == 'I' ? '-' : subject[j++];
+				if (op != 'M')
+					matchBar[k] = ' ';
+				else if (qr[k] == sr[k])
+					matchBar[k] = '|';
+				else
+					matchBar[k] = '*';
+				k++;
+			}
+		}
+		qr[length] = matchBar[length] = sr[length] = '\0';
+		printf("4) BEST ALIGNMENT STRING SIZE: %d\n", length);
+		printf("\t%s\n\t%s\n\t%s\n", qr, matchBar, sr);
+		printf("\tCIGAR: %s\n", best->cigar);
+		free(qr);
+		free(matchBar);
+		free(sr);
+	}
+	printf("5) INDEX TIME: %fs\n", indexTime);
+	printf("6) TIME ELAPSED: %fs\n", time);
+	printf("7) NUMBER OF THREADS USED: %d\n", numThreads);
+	printf("======================================\n");
+}
+
+int prependCigarOp(char* cigar, int start, char op, int length) {
+	if (length == 0)
+		return start;
+	cigar[--start] = op;
+	do {
+		cigar[--start] = '0' + length % 10;
+		length /= 10;
+	} while (length > 0);
+	return start;
+}
+
+void writeSam(Hit* hits, int numHits) {
+	printf("@HD\tVN:1.6\tSO:unsorted\n");
+	printf("@SQ\tSN:%s\tLN:%d\n", subjectName, subjectSize);
+	printf("@PG\tID:SeedExtend\tPN:SeedExtend\n");
+	if (numHits == 0) {
+		printf("%s\t4\t*\t0\t0\t*\t*\t0\t0\t%.*s\t*\n", queryName, querySize, query);
+		return;
+	}
+	for (int h = 0; h < numHits; h++) {
+		Hit* hit = &hits[h];
+		//SAM places the query on the subject, deletions at either end only move POS
+		char* cigar = hit->cigar;
+		int cigarLength = strlen(cigar);
+		int pos = hit->subjectStart;
+		char* end;
+		int n = strtol(cigar, &end, 10);
+		if (*end == 'D') {
+			pos += n;
+			cigarLength -= end + 1 - cigar;
+			cigar = end + 1;
+		}
+		if (cigarLength > 0 && cigar[cigarLength - 1] == 'D') {
+			cigarLength--;
+			while (cigarLength > 0 && cigar[cigarLength - 1] >= '0' && cigar[cigarLength - 1] <= '9')
+				cigarLength--;
+		}
+		//the best hit is the primary record, the rest are secondary
+		printf("%s\t%d\t%s\t%d\t255\t", queryName, h == 0 ? 0 : 256, subjectName, pos + 1);
+		if (hit->queryStart > 0)
+			printf("%dS", hit->queryStart);
+		printf("%.*s", cigarLength, cigar);
+		if (querySize - hit->queryEnd > 0)
+			printf("%dS", querySize - hit->queryEnd);
+		if (h == 0)
+			printf("\t*\t0\t0\t%.*s", querySize, query);
+		else
+			printf("\t*\t0\t0\t*");
+		printf("\t*\tAS:i:%ld\tNM:i:%d\n", hit->score, hit->editDistance);
+	}
+}
+
+void writePaf(Hit* hits, int numHits) {
+	for (int h = 0; h < numHits; h++) {
+		Hit* hit = &hits[h];
+		if (hit->length == 0)
+			continue;
+		printf("%s\t%d\t%d\t%d\t+\t%s\t%d\t%d\t%d\t%d\t%d\t255\ttp:A:%c\tAS:i:%ld\tNM:i:%d\tcg:Z:%s\n",
+			queryName, querySize, hit->queryStart, hit->queryEnd,
+			subjectName, subjectSize, hit->subjectStart, hit->subjectEnd,
+			hit->matches, hit->length, h == 0 ? 'P' : 'S', hit->score, hit->editDistance, hit->cigar);
+	}
+}
+
+void writeJson(Hit* hits, int numHits) {
+	//one object per line so batches can be streamed
+	for (int h = 0; h < numHits; h++) {
+		Hit* hit = &hits[h];
+		printf("{\"query\":\"%s\",\"subject\":\"%s\",\"score\":%ld,\"seeds\":%d,"
+			"\"query_start\":%d,\"query_end\":%d,\"subject_start\":%d,\"subject_end\":%d,"
+			"\"length\":%d,\"matches\":%d,\"edit_distance\":%d,\"cigar\":\"%s\"}\n",
+			queryName, subjectName, hit->score, hit->numSeeds,
+			hit->queryStart, hit->queryEnd, hit->subjectStart, hit->subjectEnd,
+			hit->length, hit->matches, hit->editDistance, hit->cigar);
+	}
+}
+
+char* baseName(char* path) {
+	char* slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+int max(int x, int y) {
+	if (x > y)
+		return x;
+	else
+		return y;
+}
+
+int min(int x, int y) {
+	if (x > y)
+		return y;
+	else
+		return x;
+}
+
+void readFiles(char* queryFile, char* subjectFile) {
+	FILE* qfp = fopen(queryFile, "r");
+	FILE* sfp = fopen(subjectFile, "r");
+
+	if (qfp) {
+		fseek(qfp, 0, SEEK_END);
+		querySize = ftell(qfp);
+		fseek(qfp, 0, SEEK_SET);
+		query = malloc(querySize);
+		if (query) {
+			fread(query, 1, querySize, qfp);
+		}
+		fclose(qfp);
+	}
+
+	if (sfp) {
+		fseek(sfp, 0, SEEK_END);
+		subjectSize = ftell(sfp);
+		fseek(sfp, 0, SEEK_SET);
+		subject = malloc(subjectSize);
+		if (subject) {
+			fread(subject, 1, subjectSize, sfp);
+		}
+		fclose(sfp);
+	}
+}